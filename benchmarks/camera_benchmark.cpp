@@ -0,0 +1,141 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Batch vs. per-point camera projection.
+//
+// map/unmap through the AbstractCamera interface (one virtual call per
+// point) against map_batch/unmap_batch, and per-point transform+project+
+// isInFrame against LinearCamera::projectInFrame. Both produce the same
+// outputs: uv and depth of all points plus the ids of the visible ones.
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <sophus/se3.h>
+
+#include <visiontools/linear_camera.h>
+#include <visiontools/stopwatch.h>
+
+using namespace VisionTools;
+
+namespace
+{
+const int NUM_POINTS = 100000;
+const int NUM_REPS = 50;
+
+double nsPerPoint(StopWatch & sw)
+{
+  return sw.get_stopped_time()*1e9/(double(NUM_POINTS)*NUM_REPS);
+}
+}
+
+int main()
+{
+  LinearCamera lin_cam(500., Vector2d(320,240), cv::Size(640,480));
+  const AbstractCamera & cam = lin_cam;
+
+  Matrix2Xd camframes = Matrix2Xd::Random(2, NUM_POINTS);
+  Matrix2Xd imframes(2, NUM_POINTS);
+  double checksum = 0;
+
+  StopWatch sw;
+  for (int r=0; r<NUM_REPS; ++r)
+  {
+    sw.start();
+    for (int i=0; i<NUM_POINTS; ++i)
+      imframes.col(i) = cam.map(camframes.col(i));
+    sw.stop();
+    checksum += imframes.sum();
+  }
+  printf("map per point:       %6.2f ns/point\n", nsPerPoint(sw));
+
+  sw.reset();
+  for (int r=0; r<NUM_REPS; ++r)
+  {
+    sw.start();
+    cam.map_batch(camframes, &imframes);
+    sw.stop();
+    checksum += imframes.sum();
+  }
+  printf("map_batch:           %6.2f ns/point\n", nsPerPoint(sw));
+
+  sw.reset();
+  for (int r=0; r<NUM_REPS; ++r)
+  {
+    sw.start();
+    for (int i=0; i<NUM_POINTS; ++i)
+      camframes.col(i) = cam.unmap(imframes.col(i));
+    sw.stop();
+    checksum += camframes.sum();
+  }
+  printf("unmap per point:     %6.2f ns/point\n", nsPerPoint(sw));
+
+  sw.reset();
+  for (int r=0; r<NUM_REPS; ++r)
+  {
+    sw.start();
+    cam.unmap_batch(imframes, &camframes);
+    sw.stop();
+    checksum += camframes.sum();
+  }
+  printf("unmap_batch:         %6.2f ns/point\n", nsPerPoint(sw));
+
+  Matrix3Xd xyz_world = Matrix3Xd::Random(3, NUM_POINTS);
+  xyz_world.row(2).array() += 2.;
+  SE3 T_cw;
+  Matrix2Xd uv;
+  VectorXd depth;
+  vector<int> visible_ids;
+
+  sw.reset();
+  for (int r=0; r<NUM_REPS; ++r)
+  {
+    sw.start();
+    uv.resize(2, NUM_POINTS);
+    depth.resize(NUM_POINTS);
+    visible_ids.clear();
+    for (int i=0; i<NUM_POINTS; ++i)
+    {
+      Vector3d xyz_cam = T_cw*Vector3d(xyz_world.col(i));
+      depth[i] = xyz_cam[2];
+      uv.col(i) = cam.map(xyz_cam.head<2>()/xyz_cam[2]);
+      if (xyz_cam[2]>0 && cam.isInFrame(Vector2d(uv.col(i)).cast<int>(), 1))
+        visible_ids.push_back(i);
+    }
+    sw.stop();
+    checksum += visible_ids.size();
+  }
+  printf("project per point:   %6.2f ns/point\n", nsPerPoint(sw));
+
+  sw.reset();
+  for (int r=0; r<NUM_REPS; ++r)
+  {
+    sw.start();
+    lin_cam.projectInFrame(xyz_world, T_cw, 1, &uv, &depth, &visible_ids);
+    sw.stop();
+    checksum += visible_ids.size();
+  }
+  printf("projectInFrame:      %6.2f ns/point\n", nsPerPoint(sw));
+
+  printf("(checksum %g)\n", checksum);
+  return EXIT_SUCCESS;
+}
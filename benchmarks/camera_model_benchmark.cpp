@@ -0,0 +1,124 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Statically vs. virtually dispatched reprojection residuals.
+//
+// The templated helpers of camera_model.h and reprojection_jacobians.h,
+// instantiated once with LinearCamera (inlined) and once with
+// AbstractCamera (one virtual call per map/jacobian).
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <sophus/se3.h>
+
+#include <visiontools/linear_camera.h>
+#include <visiontools/reprojection_jacobians.h>
+#include <visiontools/stopwatch.h>
+
+using namespace VisionTools;
+
+namespace
+{
+const int NUM_POINTS = 20000;
+const int NUM_POSES = 10;
+const int NUM_REPS = 50;
+
+double nsPerObs(StopWatch & sw, int num_obs)
+{
+  return sw.get_stopped_time()*1e9/(double(num_obs)*NUM_REPS);
+}
+
+template <class Cam>
+void timeResiduals(const char * name,
+                   const Cam & cam,
+                   const Matrix3Xd & xyz_cam,
+                   const Matrix2Xd & obs,
+                   double * checksum)
+{
+  StopWatch sw;
+  for (int r=0; r<NUM_REPS; ++r)
+  {
+    sw.start();
+    *checksum += sumSquaredReprojectionError(cam, xyz_cam, obs);
+    sw.stop();
+  }
+  printf("residuals, %-9s %6.2f ns/obs\n", name, nsPerObs(sw, obs.cols()));
+}
+
+template <class Cam>
+void timeLinearize(const char * name,
+                   const Cam & cam,
+                   const vector<SE3, aligned_allocator<SE3> > & T_cw_vec,
+                   const Matrix3Xd & xyz_world,
+                   const vector<int> & pose_ids,
+                   const vector<int> & point_ids,
+                   const Matrix2Xd & obs,
+                   double * checksum)
+{
+  Matrix2Xd residuals, J_pose, J_point;
+  StopWatch sw;
+  for (int r=0; r<NUM_REPS; ++r)
+  {
+    sw.start();
+    *checksum += linearizeReprojection(cam, T_cw_vec, xyz_world,
+                                       pose_ids, point_ids, obs,
+                                       &residuals, &J_pose, &J_point);
+    sw.stop();
+  }
+  printf("jacobians, %-9s %6.2f ns/obs\n", name, nsPerObs(sw, obs.cols()));
+}
+}
+
+int main()
+{
+  LinearCamera lin_cam(500., Vector2d(320,240), cv::Size(640,480));
+  const AbstractCamera & abs_cam = lin_cam;
+
+  Matrix3Xd xyz_world = Matrix3Xd::Random(3, NUM_POINTS);
+  xyz_world.row(2).array() += 3.;
+  Matrix2Xd point_obs = Matrix2Xd::Random(2, NUM_POINTS)*100.;
+  point_obs.colwise() += Vector2d(320,240);
+
+  vector<SE3, aligned_allocator<SE3> > T_cw_vec(NUM_POSES);
+  int num_obs = NUM_POINTS*NUM_POSES;
+  vector<int> pose_ids(num_obs);
+  vector<int> point_ids(num_obs);
+  Matrix2Xd obs(2, num_obs);
+  for (int k=0; k<num_obs; ++k)
+  {
+    pose_ids[k] = k%NUM_POSES;
+    point_ids[k] = k/NUM_POSES;
+    obs.col(k) = point_obs.col(point_ids[k]);
+  }
+
+  double checksum = 0;
+  timeResiduals("inlined", lin_cam, xyz_world, point_obs, &checksum);
+  timeResiduals("virtual", abs_cam, xyz_world, point_obs, &checksum);
+  timeLinearize("inlined", lin_cam, T_cw_vec, xyz_world, pose_ids, point_ids,
+                obs, &checksum);
+  timeLinearize("virtual", abs_cam, T_cw_vec, xyz_world, pose_ids, point_ids,
+                obs, &checksum);
+
+  printf("(checksum %g)\n", checksum);
+  return EXIT_SUCCESS;
+}
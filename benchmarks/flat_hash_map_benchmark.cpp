@@ -0,0 +1,142 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// FlatHashMap against tr1::unordered_map for int keys: sequential ids
+// (e.g. frame or point ids) and random ids, looked up in order and in
+// random order, and accumulated into with ADD_TO_MAP_ELEM. The default
+// hash is compared with FlatIdHash, which keeps only the low bits.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <tr1/unordered_map>
+#include <vector>
+
+#include <visiontools/accessor_macros.h>
+#include <visiontools/flat_hash_map.h>
+#include <visiontools/sample.h>
+#include <visiontools/stopwatch.h>
+
+using namespace VisionTools;
+
+namespace
+{
+const int NUM_KEYS = 1000000;
+const int NUM_REPS = 5;
+
+double nsPerOp(StopWatch & sw, long num_ops)
+{
+  return sw.get_stopped_time()*1e9/num_ops;
+}
+
+template <class MAP>
+void timeMap(const char * name,
+             const vector<int> & keys,
+             const vector<int> & shuffled,
+             double * checksum)
+{
+  StopWatch insert_sw;
+  StopWatch in_order_sw;
+  StopWatch random_sw;
+  StopWatch accumulate_sw;
+  StopWatch reinsert_sw;
+  for (int r=0; r<NUM_REPS; ++r)
+  {
+    MAP map;
+    insert_sw.start();
+    for (int i=0; i<NUM_KEYS; ++i)
+      map.insert(make_pair(keys[i], 1.));
+    insert_sw.stop();
+
+    double sum = 0;
+    in_order_sw.start();
+    for (int i=0; i<NUM_KEYS; ++i)
+      sum += map.find(keys[i])->second;
+    in_order_sw.stop();
+
+    random_sw.start();
+    for (int i=0; i<NUM_KEYS; ++i)
+      sum += map.find(shuffled[i])->second;
+    random_sw.stop();
+
+    accumulate_sw.start();
+    for (int i=0; i<NUM_KEYS; ++i)
+      ADD_TO_MAP_ELEM(shuffled[i], 1., &map);
+    accumulate_sw.stop();
+    *checksum += sum + map[keys[0]];
+
+    //e.g. per-frame maps: storage is already allocated and touched
+    map.clear();
+    reinsert_sw.start();
+    for (int i=0; i<NUM_KEYS; ++i)
+      map.insert(make_pair(keys[i], 1.));
+    reinsert_sw.stop();
+  }
+  long num_ops = static_cast<long>(NUM_KEYS)*NUM_REPS;
+  printf("  %-14s insert %6.1f  reinsert %6.1f  find in order %6.1f"
+         "  find random %6.1f  accumulate %6.1f ns\n",
+         name,
+         nsPerOp(insert_sw, num_ops),
+         nsPerOp(reinsert_sw, num_ops),
+         nsPerOp(in_order_sw, num_ops),
+         nsPerOp(random_sw, num_ops),
+         nsPerOp(accumulate_sw, num_ops));
+}
+
+void timeAll(const char * title, const vector<int> & keys, double * checksum)
+{
+  vector<int> shuffled = keys;
+  RandomEngine rng(1);
+  rng.subset(NUM_KEYS, &shuffled);
+  printf("%s keys:\n", title);
+  timeMap<tr1::unordered_map<int,double> >("tr1", keys, shuffled, checksum);
+  timeMap<FlatHashMap<int,double> >("flat", keys, shuffled, checksum);
+  timeMap<FlatHashMap<int,double,FlatIdHash<int> > >("flat id hash",
+                                                      keys, shuffled,
+                                                      checksum);
+}
+}
+
+int main()
+{
+  double checksum = 0;
+  vector<int> keys(NUM_KEYS);
+  for (int i=0; i<NUM_KEYS; ++i)
+    keys[i] = i;
+  timeAll("sequential", keys, &checksum);
+
+  RandomEngine rng(2);
+  FlatHashSet<int> seen;
+  for (int i=0; i<NUM_KEYS; ++i)
+  {
+    int key;
+    do
+    {
+      key = rng.uniform(0, 1<<30);
+    } while (!seen.insert(key).second);
+    keys[i] = key;
+  }
+  timeAll("random", keys, &checksum);
+
+  printf("(checksum %g)\n", checksum);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Producer/consumer throughput of SpscRingBuffer and MpscRingBuffer
+// against a bounded queue protected by a pthread mutex.
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <visiontools/concurrent_ringbuffer.h>
+#include <visiontools/stopwatch.h>
+
+using namespace VisionTools;
+
+namespace
+{
+const int CAPACITY = 1024;
+const int64_t NUM_MESSAGES = 10000000;
+
+//baseline: same interface, every operation takes the lock
+class MutexQueue
+{
+public:
+  explicit MutexQueue(int capacity)
+    : arr_(capacity), head_(0), size_(0)
+  {
+    pthread_mutex_init(&mutex_, NULL);
+  }
+
+  ~MutexQueue()
+  {
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  bool try_push(const int64_t & elem)
+  {
+    pthread_mutex_lock(&mutex_);
+    bool ok = size_<arr_.size();
+    if (ok)
+    {
+      arr_[(head_+size_)%arr_.size()] = elem;
+      ++size_;
+    }
+    pthread_mutex_unlock(&mutex_);
+    return ok;
+  }
+
+  bool try_pop(int64_t * elem)
+  {
+    pthread_mutex_lock(&mutex_);
+    bool ok = size_>0;
+    if (ok)
+    {
+      *elem = arr_[head_];
+      head_ = (head_+1)%arr_.size();
+      --size_;
+    }
+    pthread_mutex_unlock(&mutex_);
+    return ok;
+  }
+
+private:
+  std::vector<int64_t> arr_;
+  size_t head_;
+  size_t size_;
+  pthread_mutex_t mutex_;
+};
+
+template <class Queue>
+void * produce(void * queue)
+{
+  Queue * q = static_cast<Queue *>(queue);
+  for (int64_t i=0; i<NUM_MESSAGES; ++i)
+  {
+    while (!q->try_push(i))
+      sched_yield();
+  }
+  return NULL;
+}
+
+template <class Queue>
+void timeQueue(const char * name, Queue * q)
+{
+  StopWatch sw;
+  sw.start();
+  pthread_t producer;
+  pthread_create(&producer, NULL, &produce<Queue>, q);
+  int64_t sum = 0;
+  for (int64_t i=0; i<NUM_MESSAGES; ++i)
+  {
+    int64_t elem;
+    while (!q->try_pop(&elem))
+      sched_yield();
+    sum += elem;
+  }
+  pthread_join(producer, NULL);
+  sw.stop();
+  if (sum!=NUM_MESSAGES*(NUM_MESSAGES-1)/2)
+  {
+    printf("%s: lost messages\n", name);
+    exit(EXIT_FAILURE);
+  }
+  printf("%-8s %8.2f Mmsg/s\n", name,
+         NUM_MESSAGES*1e-6/sw.get_stopped_time());
+}
+}
+
+int main()
+{
+  SpscRingBuffer<int64_t> spsc(CAPACITY);
+  MpscRingBuffer<int64_t> mpsc(CAPACITY);
+  MutexQueue mutex_queue(CAPACITY);
+  timeQueue("spsc", &spsc);
+  timeQueue("mpsc", &mpsc);
+  timeQueue("mutex", &mutex_queue);
+  return EXIT_SUCCESS;
+}
@@ -53,6 +53,62 @@ public:
   virtual Matrix2d
   jacobian                   (const Vector2d& camframe) const = 0;
 
+  //Batch versions of map/unmap. Points are stored as contiguous 2xnum
+  //column-major arrays, i.e. x0,y0,x1,y1,... (same layout as Matrix2Xd).
+  //In-place operation (in==out) is allowed.
+  virtual void
+  map_batch                  (const double * camframes,
+                              int num,
+                              double * imframes) const
+  {
+    for (int i=0; i<num; ++i)
+    {
+      Map<Vector2d>(imframes+2*i) = map(Map<const Vector2d>(camframes+2*i));
+    }
+  }
+
+  virtual void
+  unmap_batch                (const double * imframes,
+                              int num,
+                              double * camframes) const
+  {
+    for (int i=0; i<num; ++i)
+    {
+      Map<Vector2d>(camframes+2*i) = unmap(Map<const Vector2d>(imframes+2*i));
+    }
+  }
+
+  void map_batch(const Matrix2Xd & camframes, Matrix2Xd * imframes) const
+  {
+    imframes->resize(2, camframes.cols());
+    map_batch(camframes.data(), camframes.cols(), imframes->data());
+  }
+
+  void unmap_batch(const Matrix2Xd & imframes, Matrix2Xd * camframes) const
+  {
+    camframes->resize(2, imframes.cols());
+    unmap_batch(imframes.data(), imframes.cols(), camframes->data());
+  }
+
+  //Non-virtual counterparts of map/unmap/jacobian. Concrete models
+  //(see camera_model.h) hide these with inlined versions, so that
+  //algorithms templated on the camera type bind statically, while
+  //instantiating them with AbstractCamera goes through the virtual calls.
+  Vector2d project(const Vector2d& camframe) const
+  {
+    return map(camframe);
+  }
+
+  Vector2d unproject(const Vector2d& imframe) const
+  {
+    return unmap(imframe);
+  }
+
+  Matrix2d projectJacobian(const Vector2d& camframe) const
+  {
+    return jacobian(camframe);
+  }
+
   double width() const
   {
     return image_size().width;
@@ -70,6 +126,8 @@ public:
       return true;
     return false;
   }
+
+  static const int obs_dim = 2;
 };
 
 }
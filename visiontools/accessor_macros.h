@@ -36,6 +36,9 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "flat_hash_map.h"
+#include "slot_map.h"
+
 namespace VisionTools
 {
 
@@ -74,6 +77,19 @@ void  ADD_TO_MAP_ELEM(const KEY & key, const VAL & val,
   }
 }
 
+//insert probes once, whether key is found or placed
+template<class KEY, class VAL, class H>
+void  ADD_TO_MAP_ELEM(const KEY & key, const VAL & val,
+                      FlatHashMap<KEY,VAL,H> * m)
+{
+  pair<typename FlatHashMap<KEY,VAL,H>::iterator,bool> res
+      = m->insert(make_pair(key,val));
+  if(!res.second)
+  {
+    res.first->second += val;
+  }
+}
+
 template<class KEY, class VAL, class H, class P, class A>
 const VAL &
 GET_MAP_ELEM(const KEY & key,
@@ -113,6 +129,35 @@ const VAL &  GET_MAP_ELEM(const KEY & key,
   return it->second;
 }
 
+template<class KEY, class VAL, class H>
+const VAL &
+GET_MAP_ELEM(const KEY & key,
+             const FlatHashMap<KEY,tr1::shared_ptr<VAL>,H> & m)
+{
+  typename FlatHashMap<KEY,tr1::shared_ptr<VAL>,H>::const_iterator it
+      = m.find(key);
+  assert(it!=m.end());
+  return *(it->second);
+}
+
+template<class KEY, class VAL, class H>
+const VAL &  GET_MAP_ELEM(const KEY & key,
+                          const FlatHashMap<KEY,VAL,H> & m)
+{
+  typename FlatHashMap<KEY,VAL,H>::const_iterator it = m.find(key);
+  assert(it!=m.end());
+  return it->second;
+}
+
+template<class VAL>
+const VAL &  GET_MAP_ELEM(const SlotHandle & key,
+                          const SlotMap<VAL> & m)
+{
+  const VAL * val = m.get(key);
+  assert(val!=NULL);
+  return *val;
+}
+
 template<class KEY, class VAL, class H, class P, class A>
 bool
 GET_MAP_ELEM_IF_THERE(const KEY & key,
@@ -175,6 +220,52 @@ GET_MAP_ELEM_IF_THERE(const KEY & key,
   return false;
 }
 
+template<class KEY, class VAL, class H>
+bool
+GET_MAP_ELEM_IF_THERE(const KEY & key,
+                      const FlatHashMap<KEY,VAL,H> & m,
+                      VAL * val)
+{
+  typename FlatHashMap<KEY,VAL,H>::const_iterator it = m.find(key);
+  if (it!=m.end())
+  {
+    *val = it->second;
+    return true;
+  }
+  return false;
+}
+
+template<class KEY, class VAL, class H>
+bool
+GET_MAP_ELEM_IF_THERE(const KEY & key,
+                      const FlatHashMap<KEY,tr1::shared_ptr<VAL>,H> & m,
+                      VAL * val)
+{
+  typename FlatHashMap<KEY,tr1::shared_ptr<VAL>,H>::const_iterator it
+      = m.find(key);
+  if (it!=m.end())
+  {
+    *val = *(it->second);
+    return true;
+  }
+  return false;
+}
+
+template<class VAL>
+bool
+GET_MAP_ELEM_IF_THERE(const SlotHandle & key,
+                      const SlotMap<VAL> & m,
+                      VAL * val)
+{
+  const VAL * found = m.get(key);
+  if (found!=NULL)
+  {
+    *val = *found;
+    return true;
+  }
+  return false;
+}
+
 template<class KEY, class VAL, class H, class P, class A>
 VAL &
 GET_MAP_ELEM_REF(const KEY & key,
@@ -215,6 +306,35 @@ VAL &  GET_MAP_ELEM_REF(const KEY & key,
   return it->second;
 }
 
+template<class KEY, class VAL, class H>
+VAL &
+GET_MAP_ELEM_REF(const KEY & key,
+                 FlatHashMap<KEY,tr1::shared_ptr<VAL>,H> * m)
+{
+  typename FlatHashMap<KEY,tr1::shared_ptr<VAL>,H>::iterator it
+      = m->find(key);
+  assert(it!=m->end());
+  return *(it->second);
+}
+
+template<class KEY, class VAL, class H>
+VAL &  GET_MAP_ELEM_REF(const KEY & key,
+                        FlatHashMap<KEY,VAL,H> * m)
+{
+  typename FlatHashMap<KEY,VAL,H>::iterator it = m->find(key);
+  assert(it!=m->end());
+  return it->second;
+}
+
+template<class VAL>
+VAL &  GET_MAP_ELEM_REF(const SlotHandle & key,
+                        SlotMap<VAL> * m)
+{
+  VAL * val = m->get(key);
+  assert(val!=NULL);
+  return *val;
+}
+
 
 template<class KEY, class VAL, class H, class P, class A>
 bool IS_IN_SET(const KEY & key,
@@ -250,6 +370,27 @@ bool IS_IN_SET(const KEY & key,
   return it!=m.end();
 }
 
+template<class VAL>
+bool IS_IN_SET(const SlotHandle & key,
+               const SlotMap<VAL> & m)
+{
+  return m.contains(key);
+}
+
+template<class KEY, class VAL, class H>
+bool IS_IN_SET(const KEY & key,
+               const FlatHashMap<KEY,VAL,H> & m)
+{
+  return m.find(key)!=m.end();
+}
+
+template<class KEY, class H>
+bool IS_IN_SET(const KEY & key,
+               const FlatHashSet<KEY,H> & m)
+{
+  return m.find(key)!=m.end();
+}
+
 template <class TYPE, class A>
 const TYPE & GET_VEC_VAL(size_t i, const vector<TYPE,A> & vec)
 {
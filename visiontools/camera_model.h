@@ -0,0 +1,132 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#ifndef VISIONTOOLS_CAMERA_MODEL_H
+#define VISIONTOOLS_CAMERA_MODEL_H
+
+#include "abstract_camera.h"
+
+namespace VisionTools
+{
+
+//CRTP base for concrete camera models. Model must define the inline
+//functions projectImpl, unprojectImpl and projectJacobianImpl (they may be
+//private if Model befriends CameraModel<Model>); a missing one is a compile
+//error since no base class declares them. CameraModel implements both the
+//statically bound project/unproject/projectJacobian, hiding the
+//AbstractCamera forwarders, and the virtual AbstractCamera facade on top.
+template <class Model>
+class CameraModel : public AbstractCamera
+{
+public:
+  Vector2d project(const Vector2d& camframe) const
+  {
+    return model().projectImpl(camframe);
+  }
+
+  Vector2d unproject(const Vector2d& imframe) const
+  {
+    return model().unprojectImpl(imframe);
+  }
+
+  Matrix2d projectJacobian(const Vector2d& camframe) const
+  {
+    return model().projectJacobianImpl(camframe);
+  }
+
+  Vector2d map(const Vector2d& camframe) const
+  {
+    return model().projectImpl(camframe);
+  }
+
+  Vector2d unmap(const Vector2d& imframe) const
+  {
+    return model().unprojectImpl(imframe);
+  }
+
+  Matrix2d jacobian(const Vector2d& camframe) const
+  {
+    return model().projectJacobianImpl(camframe);
+  }
+
+protected:
+  const Model & model() const
+  {
+    return static_cast<const Model &>(*this);
+  }
+};
+
+//Generic algorithms below are templated on the camera type: instantiated
+//with a concrete model they are fully inlined, instantiated with
+//AbstractCamera they use virtual dispatch.
+
+template <class Cam>
+inline Vector2d
+project3d(const Cam & cam, const Vector3d & xyz_cam)
+{
+  return cam.project(xyz_cam.head<2>()/xyz_cam[2]);
+}
+
+//jacobian of project3d with respect to xyz_cam
+template <class Cam>
+inline Matrix<double,Cam::obs_dim,3>
+project3dJacobian(const Cam & cam, const Vector3d & xyz_cam)
+{
+  double inv_z = 1./xyz_cam[2];
+  Vector2d uv = xyz_cam.head<2>()*inv_z;
+  Matrix<double,2,3> J_proj;
+  J_proj << inv_z, 0, -uv[0]*inv_z,
+            0, inv_z, -uv[1]*inv_z;
+  return cam.projectJacobian(uv)*J_proj;
+}
+
+//residual convention: predicted minus observed
+template <class Cam>
+inline Matrix<double,Cam::obs_dim,1>
+reprojectionError(const Cam & cam,
+                  const Vector3d & xyz_cam,
+                  const Matrix<double,Cam::obs_dim,1> & obs)
+{
+  return project3d(cam, xyz_cam) - obs;
+}
+
+template <class Cam>
+double
+sumSquaredReprojectionError(const Cam & cam,
+                            const Matrix3Xd & xyz_cam,
+                            const Matrix2Xd & obs)
+{
+  assert(xyz_cam.cols()==obs.cols());
+  double chi2 = 0;
+  for (int i=0; i<xyz_cam.cols(); ++i)
+  {
+    chi2 += reprojectionError(cam,
+                              Vector3d(xyz_cam.col(i)),
+                              Vector2d(obs.col(i))).squaredNorm();
+  }
+  return chi2;
+}
+
+}
+
+#endif
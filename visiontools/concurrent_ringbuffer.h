@@ -0,0 +1,272 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#ifndef VISIONTOOLS_CONCURRENT_RING_BUFFER_H
+#define VISIONTOOLS_CONCURRENT_RING_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cassert>
+#include <vector>
+
+namespace VisionTools
+{
+
+static const int CACHE_LINE_SIZE = 64;
+
+inline size_t nextPowerOfTwo(size_t n)
+{
+  size_t p = 1;
+  while (p<n)
+    p <<= 1;
+  return p;
+}
+
+//Bounded lock-free queue for exactly one producer and one consumer thread.
+//The capacity is rounded up to a power of two. Slots are reused in place:
+//the producer fills the slot returned by try_begin_push and publishes it
+//with end_push, the consumer reads the slot returned by try_front and
+//releases it with pop, so no element is copied. T must be default
+//constructible; slots keep their last value until overwritten.
+template<typename T>
+class SpscRingBuffer
+{
+public:
+  explicit SpscRingBuffer(int capacity)
+    : arr_(nextPowerOfTwo(capacity)),
+      mask_(arr_.size()-1),
+      head_(0),
+      cached_tail_(0),
+      tail_(0),
+      cached_head_(0)
+  {
+  }
+
+  //producer: slot to fill, or NULL if full
+  T * try_begin_push()
+  {
+    size_t tail = tail_;
+    if (tail-cached_head_>mask_)
+    {
+      cached_head_ = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+      if (tail-cached_head_>mask_)
+        return NULL;
+    }
+    return &arr_[tail&mask_];
+  }
+
+  //producer: publishes the slot returned by try_begin_push
+  void end_push()
+  {
+    __atomic_store_n(&tail_, tail_+1, __ATOMIC_RELEASE);
+  }
+
+  bool try_push(const T & elem)
+  {
+    T * slot = try_begin_push();
+    if (slot==NULL)
+      return false;
+    *slot = elem;
+    end_push();
+    return true;
+  }
+
+  //consumer: oldest element, or NULL if empty
+  T * try_front()
+  {
+    size_t head = head_;
+    if (head==cached_tail_)
+    {
+      cached_tail_ = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+      if (head==cached_tail_)
+        return NULL;
+    }
+    return &arr_[head&mask_];
+  }
+
+  //consumer: releases the slot returned by try_front
+  void pop()
+  {
+    __atomic_store_n(&head_, head_+1, __ATOMIC_RELEASE);
+  }
+
+  bool try_pop(T * elem)
+  {
+    T * slot = try_front();
+    if (slot==NULL)
+      return false;
+    *elem = *slot;
+    pop();
+    return true;
+  }
+
+  int capacity() const
+  {
+    return arr_.size();
+  }
+
+  //exact only if called while neither side is active
+  int size() const
+  {
+    return __atomic_load_n(&tail_, __ATOMIC_ACQUIRE)
+        - __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  }
+
+private:
+  SpscRingBuffer(const SpscRingBuffer &);
+  SpscRingBuffer & operator=(const SpscRingBuffer &);
+
+  std::vector<T> arr_;
+  size_t mask_;
+  char pad0_[CACHE_LINE_SIZE];
+  //written by the consumer
+  size_t head_;
+  size_t cached_tail_;
+  char pad1_[CACHE_LINE_SIZE];
+  //written by the producer
+  size_t tail_;
+  size_t cached_head_;
+  char pad2_[CACHE_LINE_SIZE];
+};
+
+//Bounded lock-free queue for many producers and one consumer, using a
+//sequence number per slot (after D. Vyukov). A producer reserves a slot
+//with try_begin_push, fills it and publishes it with end_push(ticket);
+//producers never wait for each other except on the reservation CAS.
+template<typename T>
+class MpscRingBuffer
+{
+public:
+  explicit MpscRingBuffer(int capacity)
+    : cells_(nextPowerOfTwo(capacity)),
+      mask_(cells_.size()-1),
+      tail_(0),
+      head_(0)
+  {
+    for (size_t i=0; i<cells_.size(); ++i)
+    {
+      cells_[i].seq = i;
+    }
+  }
+
+  //producer: slot to fill, or NULL if full
+  T * try_begin_push(size_t * ticket)
+  {
+    size_t pos = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+    for (;;)
+    {
+      Cell & cell = cells_[pos&mask_];
+      size_t seq = __atomic_load_n(&cell.seq, __ATOMIC_ACQUIRE);
+      intptr_t diff = static_cast<intptr_t>(seq)-static_cast<intptr_t>(pos);
+      if (diff==0)
+      {
+        if (__atomic_compare_exchange_n(&tail_, &pos, pos+1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+          *ticket = pos;
+          return &cell.data;
+        }
+      }
+      else if (diff<0)
+      {
+        return NULL;
+      }
+      else
+      {
+        pos = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+      }
+    }
+  }
+
+  //producer: publishes the slot reserved with ticket
+  void end_push(size_t ticket)
+  {
+    __atomic_store_n(&cells_[ticket&mask_].seq, ticket+1, __ATOMIC_RELEASE);
+  }
+
+  bool try_push(const T & elem)
+  {
+    size_t ticket;
+    T * slot = try_begin_push(&ticket);
+    if (slot==NULL)
+      return false;
+    *slot = elem;
+    end_push(ticket);
+    return true;
+  }
+
+  //consumer: oldest published element, or NULL if empty
+  T * try_front()
+  {
+    Cell & cell = cells_[head_&mask_];
+    if (__atomic_load_n(&cell.seq, __ATOMIC_ACQUIRE)!=head_+1)
+      return NULL;
+    return &cell.data;
+  }
+
+  //consumer: releases the slot returned by try_front
+  void pop()
+  {
+    __atomic_store_n(&cells_[head_&mask_].seq, head_+mask_+1,
+                     __ATOMIC_RELEASE);
+    ++head_;
+  }
+
+  bool try_pop(T * elem)
+  {
+    T * slot = try_front();
+    if (slot==NULL)
+      return false;
+    *elem = *slot;
+    pop();
+    return true;
+  }
+
+  int capacity() const
+  {
+    return cells_.size();
+  }
+
+private:
+  MpscRingBuffer(const MpscRingBuffer &);
+  MpscRingBuffer & operator=(const MpscRingBuffer &);
+
+  struct Cell
+  {
+    size_t seq;
+    T data;
+  };
+
+  std::vector<Cell> cells_;
+  size_t mask_;
+  char pad0_[CACHE_LINE_SIZE];
+  size_t tail_;
+  char pad1_[CACHE_LINE_SIZE];
+  size_t head_;
+  char pad2_[CACHE_LINE_SIZE];
+};
+
+}
+
+#endif
@@ -0,0 +1,203 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#include <algorithm>
+
+#include <Eigen/LU>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "distorted_camera.h"
+
+namespace VisionTools
+{
+
+DistortedCamera
+::DistortedCamera(const double & focal_length,
+                  const Vector2d & principle_point,
+                  const cv::Size & size)
+  : focal_length_(focal_length),
+    principle_point_(principle_point),
+    image_size_(size),
+    intrinsics_(Matrix3d::Identity()),
+    intrinsics_inv_(Matrix3d::Identity()),
+    table_step_(0),
+    inv_table_step_(0),
+    table_width_(0),
+    table_height_(0)
+{
+  initialise();
+}
+
+void DistortedCamera
+::initialise()
+{
+  inv_focal_length_ = 1./focal_length_;
+  intrinsics_(0,0) = focal_length_;
+  intrinsics_(1,1) = focal_length_;
+  intrinsics_(0,2) = principle_point_[0];
+  intrinsics_(1,2) = principle_point_[1];
+  intrinsics_inv_(0,0) = inv_focal_length_;
+  intrinsics_inv_(1,1) = inv_focal_length_;
+  intrinsics_inv_(0,2) = -principle_point_[0]*inv_focal_length_;
+  intrinsics_inv_(1,2) = -principle_point_[1]*inv_focal_length_;
+}
+
+Vector2d DistortedCamera
+::map(const Vector2d& point) const
+{
+  return focal_length_*distort(point) + principle_point_;
+}
+
+Matrix2d DistortedCamera
+::jacobian(const Vector2d& point) const
+{
+  return focal_length_*distortJacobian(point);
+}
+
+Vector2d DistortedCamera
+::undistort(const Vector2d& dist) const
+{
+  Vector2d undist = dist;
+  for (int i=0; i<20; ++i)
+  {
+    Vector2d r = distort(undist)-dist;
+    if (r.squaredNorm()<1e-24)
+      break;
+    undist -= distortJacobian(undist).inverse()*r;
+  }
+  return undist;
+}
+
+Vector2d DistortedCamera
+::unmap(const Vector2d& dist_point) const
+{
+  if (table_step_>0)
+  {
+    double gx = dist_point[0]*inv_table_step_;
+    double gy = dist_point[1]*inv_table_step_;
+    int x0 = static_cast<int>(gx);
+    int y0 = static_cast<int>(gy);
+    if (gx>=0 && gy>=0 && x0<table_width_-1 && y0<table_height_-1)
+    {
+      double ax = gx-x0;
+      double ay = gy-y0;
+      int idx = y0*table_width_+x0;
+      return (1-ay)*((1-ax)*unmap_table_.col(idx)
+                     + ax*unmap_table_.col(idx+1))
+          + ay*((1-ax)*unmap_table_.col(idx+table_width_)
+                + ax*unmap_table_.col(idx+table_width_+1));
+    }
+  }
+  return undistort(inv_focal_length_*(dist_point-principle_point_));
+}
+
+void DistortedCamera
+::computeUnmapTable(int step)
+{
+  assert(step>0);
+  clearUnmapTable();
+  //one extra node past the last pixel, so that the whole image is covered
+  int width = (image_size_.width-1)/step + 2;
+  int height = (image_size_.height-1)/step + 2;
+  Matrix2Xd table(2, width*height);
+
+#pragma omp parallel for
+  for (int y=0; y<height; ++y)
+  {
+    for (int x=0; x<width; ++x)
+    {
+      table.col(y*width+x)
+          = undistort(inv_focal_length_
+                      *(Vector2d(x*step, y*step)-principle_point_));
+    }
+  }
+  unmap_table_.swap(table);
+  table_width_ = width;
+  table_height_ = height;
+  inv_table_step_ = 1./step;
+  table_step_ = step;
+}
+
+void DistortedCamera
+::clearUnmapTable()
+{
+  table_step_ = 0;
+  inv_table_step_ = 0;
+  table_width_ = 0;
+  table_height_ = 0;
+  unmap_table_.resize(2,0);
+}
+
+void DistortedCamera
+::computeRectifyMap(const LinearCamera & rect_cam)
+{
+  const cv::Size & size = rect_cam.image_size();
+  rectify_map_x_.create(size, CV_32FC1);
+  rectify_map_y_.create(size, CV_32FC1);
+
+#pragma omp parallel for
+  for (int y=0; y<size.height; ++y)
+  {
+    float * map_x = rectify_map_x_.ptr<float>(y);
+    float * map_y = rectify_map_y_.ptr<float>(y);
+    for (int x=0; x<size.width; ++x)
+    {
+      Vector2d uv = map(rect_cam.unmap(Vector2d(x,y)));
+      map_x[x] = uv[0];
+      map_y[x] = uv[1];
+    }
+  }
+}
+
+void DistortedCamera
+::rectify(const cv::Mat & img, cv::Mat * rect_img) const
+{
+  assert(hasRectifyMap());
+  assert(img.size()==image_size_);
+  rect_img->create(rectify_map_x_.size(), img.type());
+
+  int rows = rectify_map_x_.rows;
+  int num_bands = 1;
+#ifdef _OPENMP
+  num_bands = std::min(omp_get_max_threads(), rows);
+#endif
+
+#pragma omp parallel for
+  for (int b=0; b<num_bands; ++b)
+  {
+    int begin = rows*b/num_bands;
+    int end = rows*(b+1)/num_bands;
+    cv::Mat band = rect_img->rowRange(begin, end);
+    cv::remap(img, band,
+              rectify_map_x_.rowRange(begin, end),
+              rectify_map_y_.rowRange(begin, end),
+              cv::INTER_LINEAR);
+  }
+}
+
+}
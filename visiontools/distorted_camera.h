@@ -0,0 +1,124 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#ifndef VISIONTOOLS_DISTORTED_CAMERA_H
+#define VISIONTOOLS_DISTORTED_CAMERA_H
+
+#include "abstract_camera.h"
+#include "linear_camera.h"
+
+namespace VisionTools
+{
+
+//Base class for camera models with lens distortion. A model is a linear
+//camera (focal length, principal point) applied after a distortion on the
+//normalised image plane; derived classes only provide distort and its
+//jacobian.
+class DistortedCamera : public AbstractCamera
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  DistortedCamera          (const double & focal_length,
+                            const Vector2d & principle_point,
+                            const cv::Size & image_size);
+  virtual ~DistortedCamera (){}
+
+  Vector2d
+  map                      (const Vector2d& camframe) const;
+  Vector2d                 //table lookup if there is an unmap table
+  unmap                    (const Vector2d& imframe) const;
+  Matrix2d
+  jacobian                 (const Vector2d& camframe) const;
+
+  virtual Vector2d         //normalised undistorted -> normalised distorted
+  distort                  (const Vector2d& undist) const = 0;
+  virtual Matrix2d
+  distortJacobian          (const Vector2d& undist) const = 0;
+  Vector2d                 //Gauss-Newton inversion of distort
+  undistort                (const Vector2d& dist) const;
+
+  void                     //precompute unmap on a grid with spacing step
+  computeUnmapTable        (int step=1);
+  void
+  clearUnmapTable          ();
+  void                     //precompute pixel map for rectify
+  computeRectifyMap        (const LinearCamera & rect_cam);
+  void                     //requires computeRectifyMap
+  rectify                  (const cv::Mat & img,
+                            cv::Mat * rect_img) const;
+
+  const cv::Size & image_size() const
+  {
+    return image_size_;
+  }
+  const Vector2d& principal_point() const
+  {
+    return principle_point_;
+  }
+  const double & focal_length() const
+  {
+    return focal_length_;
+  }
+  const Matrix3d& intrinsics() const
+  {
+    return intrinsics_;
+  }
+  const Matrix3d& intrinsics_inv() const
+  {
+    return intrinsics_inv_;
+  }
+  bool hasUnmapTable() const
+  {
+    return table_step_>0;
+  }
+  bool hasRectifyMap() const
+  {
+    return !rectify_map_x_.empty();
+  }
+
+protected:
+  void initialise();
+
+  double focal_length_;
+  Vector2d principle_point_;
+  cv::Size image_size_;
+  Matrix3d intrinsics_;
+  Matrix3d intrinsics_inv_;
+  double inv_focal_length_;
+
+  //unmap table: normalised points at pixels (i*step, j*step), stored
+  //row-major in a 2 x (table_width_*table_height_) matrix
+  int table_step_;
+  double inv_table_step_;
+  int table_width_;
+  int table_height_;
+  Matrix2Xd unmap_table_;
+
+  cv::Mat rectify_map_x_;
+  cv::Mat rectify_map_y_;
+};
+
+}
+
+#endif
@@ -22,11 +22,31 @@
 #include "draw2d.h"
 
 #include <iostream>
+#include <vector>
 #include <Eigen/Eigenvalues>
 
+#include "gl_texture.h"
 
 namespace VisionTools
 {
+namespace
+{
+//Small LRU cache of textures, keyed by image size and type: enough for a
+//few live video feeds, while one-off sizes (patches, ROIs, pyramid levels)
+//are evicted instead of piling up.
+struct CachedTexture
+{
+  int width;
+  int height;
+  int type;
+  long last_use;
+  GlTexture * texture;
+};
+
+const size_t MAX_CACHED_TEXTURES = 8;
+vector<CachedTexture> texture_cache;
+long texture_clock = 0;
+}
 
 void Draw2d::
 activate(const cv::Size & size_in_pixel)
@@ -160,133 +180,68 @@ box(const cv::Rect_<double> & r)
   assert(checkForGlError());
 }
 
-//TODO: method too long
+//Textures are cached by size and type, so a video feed reuses the same
+//GL storage every frame. Repeated sizes are streamed through the pixel
+//buffer objects of GlTexture; the first upload of a size goes direct.
 void Draw2d::
 texture(const cv::Mat & img, const Vector2i top_left)
 {
-  glEnable(GL_TEXTURE_2D);
-  GLuint texture;
-  glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
-  if (img.type()==CV_8UC1)
-  {
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_LUMINANCE,
-                 img.size().width,
-                 img.size().height,
-                 0,
-                 GL_LUMINANCE,
-                 GL_UNSIGNED_BYTE,
-                 img.data);
-  }
-  else if (img.type()==CV_16S)
-  {
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_LUMINANCE,
-                 img.size().width,
-                 img.size().height,
-                 0,
-                 GL_LUMINANCE,
-                 GL_UNSIGNED_SHORT,
-                 img.data);
-  }
-  else if (img.type()==CV_8UC3)
-  {
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGB8,
-                 img.size().width,
-                 img.size().height,
-                 0,
-                 GL_BGR,
-                 GL_UNSIGNED_BYTE,
-                 img.data);
-  }
-  else if (img.type()==CV_8UC4)
-  {
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGB8,
-                 img.size().width,
-                 img.size().height,
-                 0,
-                 GL_BGRA,
-                 GL_UNSIGNED_BYTE,
-                 img.data);
-  }
-  else if (img.type()==CV_16UC1 || img.type()==CV_8UC2)
+  ++texture_clock;
+  CachedTexture * entry = NULL;
+  for (size_t i=0; i<texture_cache.size(); ++i)
   {
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_LUMINANCE,
-                 img.size().width,
-                 img.size().height,
-                 0,
-                 GL_LUMINANCE,
-                 GL_UNSIGNED_SHORT,
-                 img.data);
+    CachedTexture & c = texture_cache[i];
+    if (c.width==img.cols && c.height==img.rows && c.type==img.type())
+    {
+      entry = &c;
+      break;
+    }
   }
-  else if (img.type()==CV_32FC1)
+  bool ok;
+  if (entry!=NULL)
   {
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_LUMINANCE,
-                 img.size().width,
-                 img.size().height,
-                 0,
-                 GL_LUMINANCE,
-                 GL_FLOAT,
-                 img.data);
+    ok = entry->texture->stream(img);
   }
-  else if (img.type()==CV_32FC3)
+  else
   {
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGB8,
-                 img.size().width,
-                 img.size().height,
-                 0,
-                 GL_BGR,
-                 GL_FLOAT,
-                 img.data);
+    if (texture_cache.size()<MAX_CACHED_TEXTURES)
+    {
+      texture_cache.push_back(CachedTexture());
+      entry = &texture_cache.back();
+      entry->texture = new GlTexture();
+    }
+    else
+    {
+      entry = &texture_cache[0];
+      for (size_t i=1; i<texture_cache.size(); ++i)
+      {
+        if (texture_cache[i].last_use<entry->last_use)
+          entry = &texture_cache[i];
+      }
+      entry->texture->release();
+    }
+    entry->width = img.cols;
+    entry->height = img.rows;
+    entry->type = img.type();
+    ok = entry->texture->upload(img);
   }
-  else if (img.type()==CV_32FC4)
+  entry->last_use = texture_clock;
+  if (!ok)
   {
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGBA8,
-                 img.size().width,
-                 img.size().height,
-                 0,
-                 GL_RGBA,
-                 GL_FLOAT,
-                 img.data);
-  }
-  else
-  {
-    cerr << "Unknown texture type" << img.type() << endl;
     assert(false);
+    return;
   }
-  glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
-  glBindTexture(GL_TEXTURE_2D, texture);
-
-  int x = top_left[0];
-  int y  = top_left[1];
-  int w = img.size().width;
-  int h  = img.size().height;
-
-  glBegin(GL_QUADS);
-  glTexCoord2f(0.0f, 0.0f); glVertex2i(x, y);
-  glTexCoord2f(0.0f, 1.0f); glVertex2i(x, y+h);
-  glTexCoord2f(1.0f, 1.0f); glVertex2i(x+w, y+h);
-  glTexCoord2f(1.0f, 0.0f); glVertex2i(x+w, y);
-  glEnd();
+  entry->texture->draw(top_left);
+}
 
-  glDeleteTextures(1,&texture);
-  glDisable(GL_TEXTURE_2D);
+void Draw2d::
+releaseTextures()
+{
+  for (size_t i=0; i<texture_cache.size(); ++i)
+  {
+    delete texture_cache[i].texture;
+  }
+  texture_cache.clear();
 }
 
 //TODO: remove redundant code with Draw3d
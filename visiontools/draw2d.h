@@ -51,6 +51,8 @@ struct Draw2d
                               GLUquadric * quad,
                               double number_of_sigma=3,
                               double ring_thickness=1 );
+  //single primitives in immediate mode; for many lines or boxes per frame
+  //collect them in a GlLineBatch and flush once
   static void
   line                       (const Vector2d & p1,
                               const Vector2d & p2);
@@ -60,6 +62,9 @@ struct Draw2d
   static void
   texture                    (const cv::Mat & img,
                               const Vector2i top_left = Vector2i(0.,0.));
+  //frees the textures cached by texture(); call while the context is current
+  static void
+  releaseTextures            ();
   static bool
   checkForGlError();
 private:
@@ -25,6 +25,7 @@
 
 #include "gl_data.h"
 #include "linear_camera.h"
+#include "point_cloud.h"
 
 namespace Sophus
 {
@@ -61,9 +62,16 @@ struct Draw3d
   coloredPoints              (const vector<GlPoint3f> & point_vec,
                               const vector<GlPoint4f> & color_vec,
                               double pixel_size);
+  //draws straight from the cloud's arrays, with its colors if enabled
+  template <class SCALAR>
+  static void
+  points                     (const PointCloud<SCALAR> & cloud,
+                              double pixel_size);
   static void
   point                      (const GlPoint3f & point,
                               double pixel_size);
+  //single primitives in immediate mode; for many lines or poses per frame
+  //collect them in a GlLineBatch and flush once
   static void
   pose                       (const SE3 & T_world_from_cam, double size = 0.1);
 
@@ -81,6 +89,29 @@ struct Draw3d
   checkForGlError            ();
 };
 
+template <class SCALAR>
+void Draw3d
+::points(const PointCloud<SCALAR> & cloud, double pixel_size)
+{
+  if (cloud.size()==0)
+    return;
+  glEnable(GL_POINT_SMOOTH);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glPointSize(pixel_size);
+  glVertexPointer(3, cloud.gl_type(), 0, cloud.xyz_data());
+  if (cloud.has_colors())
+  {
+    glEnableClientState(GL_COLOR_ARRAY);
+    glColorPointer(4, GL_FLOAT, 0, cloud.color_data());
+  }
+  glDrawArrays(GL_POINTS, 0, cloud.size());
+  if (cloud.has_colors())
+    glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glDisable(GL_POINT_SMOOTH);
+  assert(checkForGlError());
+}
+
 }
 
 #endif
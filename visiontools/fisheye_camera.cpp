@@ -0,0 +1,77 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#include <cmath>
+
+#include "fisheye_camera.h"
+
+namespace VisionTools
+{
+
+FisheyeCamera
+::FisheyeCamera(const double & focal_length,
+                const Vector2d & principle_point,
+                const cv::Size & size,
+                const Vector4d & dist_coeffs)
+  : DistortedCamera(focal_length, principle_point, size),
+    dist_coeffs_(dist_coeffs)
+{
+}
+
+Vector2d FisheyeCamera
+::distort(const Vector2d& undist) const
+{
+  double r = undist.norm();
+  if (r<1e-8)
+    return undist;
+  double theta = std::atan(r);
+  double theta2 = theta*theta;
+  double theta_d
+      = theta*(1. + theta2*(dist_coeffs_[0] + theta2*(dist_coeffs_[1]
+               + theta2*(dist_coeffs_[2] + theta2*dist_coeffs_[3]))));
+  return (theta_d/r)*undist;
+}
+
+Matrix2d FisheyeCamera
+::distortJacobian(const Vector2d& undist) const
+{
+  double r = undist.norm();
+  if (r<1e-8)
+    return Matrix2d::Identity();
+  double theta = std::atan(r);
+  double theta2 = theta*theta;
+  double theta_d
+      = theta*(1. + theta2*(dist_coeffs_[0] + theta2*(dist_coeffs_[1]
+               + theta2*(dist_coeffs_[2] + theta2*dist_coeffs_[3]))));
+  double d_theta_d
+      = 1. + theta2*(3.*dist_coeffs_[0] + theta2*(5.*dist_coeffs_[1]
+             + theta2*(7.*dist_coeffs_[2] + theta2*9.*dist_coeffs_[3])));
+  double inv_r = 1./r;
+  double scale = theta_d*inv_r;
+  //d scale / d r, using d theta / d r = 1/(1+r^2)
+  double d_scale = (d_theta_d/(1.+r*r) - scale)*inv_r;
+  return scale*Matrix2d::Identity()
+      + (d_scale*inv_r)*undist*undist.transpose();
+}
+
+}
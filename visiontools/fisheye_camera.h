@@ -0,0 +1,62 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#ifndef VISIONTOOLS_FISHEYE_CAMERA_H
+#define VISIONTOOLS_FISHEYE_CAMERA_H
+
+#include "distorted_camera.h"
+
+namespace VisionTools
+{
+
+//Equidistant fisheye model (Kannala-Brandt) with coefficients
+//(k1, k2, k3, k4): theta_d = theta*(1 + k1*theta^2 + ... + k4*theta^8).
+class FisheyeCamera : public DistortedCamera
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  FisheyeCamera            (const double & focal_length,
+                            const Vector2d & principle_point,
+                            const cv::Size & image_size,
+                            const Vector4d & dist_coeffs);
+  Vector2d
+  distort                  (const Vector2d& undist) const;
+  Matrix2d
+  distortJacobian          (const Vector2d& undist) const;
+
+  const Vector4d & dist_coeffs() const
+  {
+    return dist_coeffs_;
+  }
+
+  static const int obs_dim = 2;
+  static const int NUM_PARAMS = 8;
+
+protected:
+  Vector4d dist_coeffs_;
+};
+
+}
+
+#endif
@@ -0,0 +1,538 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_FLAT_HASH_MAP_H
+#define VISIONTOOLS_FLAT_HASH_MAP_H
+
+#include <stdint.h>
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+#include <tr1/functional>
+
+namespace VisionTools
+{
+using namespace std;
+
+//Identity hash for integer-like ids without a tr1::hash of their own.
+//Used as HASH of FlatHashMap/FlatHashSet, the low bits of the id select
+//the slot, without the mixing of the high bits that the default gives
+//integral keys. Ids with a large power of two stride all land in few
+//slots; those stay correct but slow.
+template <class KEY>
+struct FlatIdHash
+{
+  size_t operator()(KEY key) const
+  {
+    return static_cast<size_t>(key);
+  }
+};
+
+//Maps a hash value to a home slot. By default Fibonacci hashing: the high
+//bits of hash*2^64/phi, which spreads even identity hashes of strided or
+//pointer keys. FlatIdHash skips the scrambling.
+template <class HASH>
+struct FlatHashSlot
+{
+  static size_t home(size_t hash, int shift, size_t mask)
+  {
+    return (static_cast<uint64_t>(hash)*0x9E3779B97F4A7C15ULL) >> shift;
+  }
+};
+
+template <class KEY>
+struct FlatHashSlot<FlatIdHash<KEY> >
+{
+  static size_t home(size_t hash, int shift, size_t mask)
+  {
+    return hash & mask;
+  }
+};
+
+//tr1::hash of an integral key is the key itself. Its low bits are kept and
+//only the bits above the mask are Fibonacci hashed into them, so dense ids
+//(e.g. 0..n-1 frame or point ids) occupy consecutive slots and scans over
+//id ranges stay cache friendly, while strided keys are still spread.
+struct FlatIntegerSlot
+{
+  static size_t home(size_t hash, int shift, size_t mask)
+  {
+    //predictable for dense ids, and keeps the multiplication off their path
+    if (hash<=mask)
+      return hash;
+    uint64_t high = static_cast<uint64_t>(hash) >> (64-shift);
+    return (hash ^ ((high*0x9E3779B97F4A7C15ULL) >> shift)) & mask;
+  }
+};
+
+#define VISIONTOOLS_FLAT_INTEGER_SLOT(T)                                    \
+  template <>                                                               \
+  struct FlatHashSlot<tr1::hash<T> > : public FlatIntegerSlot {};
+
+VISIONTOOLS_FLAT_INTEGER_SLOT(short)
+VISIONTOOLS_FLAT_INTEGER_SLOT(unsigned short)
+VISIONTOOLS_FLAT_INTEGER_SLOT(int)
+VISIONTOOLS_FLAT_INTEGER_SLOT(unsigned int)
+VISIONTOOLS_FLAT_INTEGER_SLOT(long)
+VISIONTOOLS_FLAT_INTEGER_SLOT(unsigned long)
+VISIONTOOLS_FLAT_INTEGER_SLOT(long long)
+VISIONTOOLS_FLAT_INTEGER_SLOT(unsigned long long)
+
+#undef VISIONTOOLS_FLAT_INTEGER_SLOT
+
+//Slots store value_type with a mutable key, so that entries can be moved
+//around; iterators expose it as value_type (e.g. with a const key).
+template <class T>
+struct FlatMutable
+{
+  typedef T type;
+};
+
+template <class KEY, class VAL>
+struct FlatMutable<pair<const KEY,VAL> >
+{
+  typedef pair<KEY,VAL> type;
+};
+
+//Open addressing hash table with robin hood linear probing and backward
+//shift deletion: all entries live in one array, lookups touch one or two
+//cache lines and never allocate. The home slot of a key is given by
+//FlatHashSlot<HASH>. Probe distances are not bounded, so a poor hash
+//only makes operations slower; the table never grows beyond its load
+//factor. KEY and VALUE_TYPE must be default constructible and assignable.
+//Iterators and references are invalidated by insertions and erasures.
+template <class KEY, class VALUE_TYPE, class KEY_OF, class HASH>
+class FlatHashTable
+{
+public:
+  typedef KEY key_type;
+  typedef VALUE_TYPE value_type;
+  typedef size_t size_type;
+  typedef typename FlatMutable<VALUE_TYPE>::type stored_type;
+
+  struct Slot
+  {
+    Slot() : dist(0) {}
+
+    stored_type value;
+    uint32_t dist;           //probe distance + 1, 0 marks an empty slot
+  };
+
+  template <class V, class S>
+  class Iterator
+  {
+  public:
+    Iterator() : slot_(NULL), end_(NULL) {}
+
+    Iterator(S * slot, S * end)
+      : slot_(slot), end_(end)
+    {
+      skipEmpty();
+    }
+
+    //iterator -> const_iterator
+    template <class W, class T>
+    Iterator(const Iterator<W,T> & other)
+      : slot_(other.slot_), end_(other.end_)
+    {
+    }
+
+    V & operator*() const
+    {
+      return reinterpret_cast<V &>(slot_->value);
+    }
+
+    V * operator->() const
+    {
+      return &**this;
+    }
+
+    Iterator & operator++()
+    {
+      ++slot_;
+      skipEmpty();
+      return *this;
+    }
+
+    template <class W, class T>
+    bool operator==(const Iterator<W,T> & other) const
+    {
+      return slot_==other.slot_;
+    }
+
+    template <class W, class T>
+    bool operator!=(const Iterator<W,T> & other) const
+    {
+      return slot_!=other.slot_;
+    }
+
+  private:
+    template <class W, class T> friend class Iterator;
+    friend class FlatHashTable;
+
+    void skipEmpty()
+    {
+      while (slot_!=end_ && slot_->dist==0)
+        ++slot_;
+    }
+
+    S * slot_;
+    S * end_;
+  };
+
+  typedef Iterator<value_type, Slot> iterator;
+  typedef Iterator<const value_type, const Slot> const_iterator;
+
+  FlatHashTable() : size_(0), shift_(64)
+  {
+  }
+
+  iterator begin()
+  {
+    return makeIterator(0);
+  }
+
+  iterator end()
+  {
+    return makeIterator(slots_.size());
+  }
+
+  const_iterator begin() const
+  {
+    return makeIterator(0);
+  }
+
+  const_iterator end() const
+  {
+    return makeIterator(slots_.size());
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  bool empty() const
+  {
+    return size_==0;
+  }
+
+  iterator find(const KEY & key)
+  {
+    return makeIterator(findIndex(key));
+  }
+
+  const_iterator find(const KEY & key) const
+  {
+    return makeIterator(findIndex(key));
+  }
+
+  size_t count(const KEY & key) const
+  {
+    return findIndex(key)==slots_.size() ? 0 : 1;
+  }
+
+  //a single probe, which stops where val is or would be placed
+  pair<iterator,bool>
+  insert                     (const value_type & val);
+
+  size_t
+  erase                      (const KEY & key);
+
+  void
+  erase                      (iterator it);
+
+  void
+  clear                      ();
+
+  //capacity for num elements without rehashing
+  void
+  reserve                    (size_t num);
+
+  void swap(FlatHashTable & other)
+  {
+    slots_.swap(other.slots_);
+    std::swap(size_, other.size_);
+    std::swap(shift_, other.shift_);
+  }
+
+protected:
+  iterator makeIterator(size_t i)
+  {
+    Slot * first = slots_.empty() ? NULL : &slots_[0];
+    return iterator(first+i, first+slots_.size());
+  }
+
+  const_iterator makeIterator(size_t i) const
+  {
+    const Slot * first = slots_.empty() ? NULL : &slots_[0];
+    return const_iterator(first+i, first+slots_.size());
+  }
+
+  size_t home(const KEY & key) const
+  {
+    return FlatHashSlot<HASH>::home(hash_(key), shift_, slots_.size()-1);
+  }
+
+  size_t findIndex(const KEY & key) const
+  {
+    size_t stop;
+    uint32_t stop_dist;
+    return findIndex(key, &stop, &stop_dist);
+  }
+
+  size_t
+  findIndex                  (const KEY & key,
+                              size_t * stop,
+                              uint32_t * stop_dist) const;
+  void
+  insertNew                  (stored_type * val,
+                              size_t i,
+                              uint32_t d,
+                              size_t * pos);
+  void
+  rehash                     (size_t capacity);
+
+  vector<Slot> slots_;       //distance stored inline: one cache miss per probe
+  size_t size_;
+  int shift_;
+  KEY_OF key_of_;
+  HASH hash_;
+};
+
+//Returns the slot of key, or the capacity if key is absent. Then *stop is
+//the slot at which the probe ended with distance *stop_dist, which is
+//where key would be inserted.
+template <class KEY, class VALUE_TYPE, class KEY_OF, class HASH>
+size_t FlatHashTable<KEY,VALUE_TYPE,KEY_OF,HASH>
+::findIndex(const KEY & key, size_t * stop, uint32_t * stop_dist) const
+{
+  size_t capacity = slots_.size();
+  *stop = capacity;
+  *stop_dist = 1;
+  if (capacity==0)
+    return capacity;
+  size_t mask = capacity-1;
+  size_t i = home(key);
+  uint32_t d = 1;
+  //robin hood invariant: once our distance exceeds the slot's, key is absent
+  for (; d<=slots_[i].dist; ++d)
+  {
+    if (key_of_(slots_[i].value)==key)
+      return i;
+    i = (i+1) & mask;
+  }
+  *stop = i;
+  *stop_dist = d;
+  return capacity;
+}
+
+//Places *val, which must not be in the table and for which there must be
+//a free slot, starting at slot i with distance d, swapping it with richer
+//entries on the way; *pos is where it ended up.
+template <class KEY, class VALUE_TYPE, class KEY_OF, class HASH>
+void FlatHashTable<KEY,VALUE_TYPE,KEY_OF,HASH>
+::insertNew(stored_type * val, size_t i, uint32_t d, size_t * pos)
+{
+  size_t mask = slots_.size()-1;
+  *pos = slots_.size();
+  for (;;)
+  {
+    Slot & slot = slots_[i];
+    if (slot.dist==0)
+    {
+      slot.value = *val;
+      slot.dist = d;
+      ++size_;
+      if (*pos==slots_.size())
+        *pos = i;
+      return;
+    }
+    if (slot.dist<d)
+    {
+      std::swap(slot.value, *val);
+      std::swap(slot.dist, d);
+      if (*pos==slots_.size())
+        *pos = i;
+    }
+    i = (i+1) & mask;
+    ++d;
+  }
+}
+
+template <class KEY, class VALUE_TYPE, class KEY_OF, class HASH>
+void FlatHashTable<KEY,VALUE_TYPE,KEY_OF,HASH>
+::rehash(size_t capacity)
+{
+  vector<Slot> old_slots(capacity);
+  old_slots.swap(slots_);
+  size_ = 0;
+  shift_ = 64;
+  for (size_t c=capacity; c>1; c>>=1)
+    --shift_;
+  size_t pos;
+  for (size_t i=0; i<old_slots.size(); ++i)
+  {
+    if (old_slots[i].dist!=0)
+    {
+      insertNew(&old_slots[i].value, home(key_of_(old_slots[i].value)), 1,
+                &pos);
+    }
+  }
+}
+
+template <class KEY, class VALUE_TYPE, class KEY_OF, class HASH>
+void FlatHashTable<KEY,VALUE_TYPE,KEY_OF,HASH>
+::reserve(size_t num)
+{
+  //maximal load factor 3/4
+  size_t capacity = 8;
+  while (capacity*3 < num*4)
+    capacity *= 2;
+  if (capacity>slots_.size())
+    rehash(capacity);
+}
+
+template <class KEY, class VALUE_TYPE, class KEY_OF, class HASH>
+pair<typename FlatHashTable<KEY,VALUE_TYPE,KEY_OF,HASH>::iterator,bool>
+FlatHashTable<KEY,VALUE_TYPE,KEY_OF,HASH>
+::insert(const value_type & val)
+{
+  const KEY & key = key_of_(val);
+  size_t stop;
+  uint32_t d;
+  size_t i = findIndex(key, &stop, &d);
+  if (i!=slots_.size())
+    return make_pair(makeIterator(i), false);
+  if ((size_+1)*4 > slots_.size()*3)
+  {
+    reserve(size_+1);
+    stop = home(key);
+    d = 1;
+  }
+  stored_type v(val);
+  insertNew(&v, stop, d, &i);
+  return make_pair(makeIterator(i), true);
+}
+
+template <class KEY, class VALUE_TYPE, class KEY_OF, class HASH>
+size_t FlatHashTable<KEY,VALUE_TYPE,KEY_OF,HASH>
+::erase(const KEY & key)
+{
+  iterator it = find(key);
+  if (it==end())
+    return 0;
+  erase(it);
+  return 1;
+}
+
+template <class KEY, class VALUE_TYPE, class KEY_OF, class HASH>
+void FlatHashTable<KEY,VALUE_TYPE,KEY_OF,HASH>
+::erase(iterator it)
+{
+  size_t i = it.slot_-&slots_[0];
+  assert(i<slots_.size() && slots_[i].dist!=0);
+  size_t mask = slots_.size()-1;
+  size_t j = (i+1) & mask;
+  while (slots_[j].dist>1)
+  {
+    slots_[i].value = slots_[j].value;
+    slots_[i].dist = slots_[j].dist-1;
+    i = j;
+    j = (j+1) & mask;
+  }
+  slots_[i].value = stored_type();
+  slots_[i].dist = 0;
+  --size_;
+}
+
+template <class KEY, class VALUE_TYPE, class KEY_OF, class HASH>
+void FlatHashTable<KEY,VALUE_TYPE,KEY_OF,HASH>
+::clear()
+{
+  for (size_t i=0; i<slots_.size(); ++i)
+  {
+    if (slots_[i].dist!=0)
+    {
+      slots_[i].value = stored_type();
+      slots_[i].dist = 0;
+    }
+  }
+  size_ = 0;
+}
+
+//for both the stored pair and value_type, without converting between them
+struct FlatFirst
+{
+  template <class PAIR>
+  const typename PAIR::first_type & operator()(const PAIR & p) const
+  {
+    return p.first;
+  }
+};
+
+template <class KEY>
+struct FlatIdentity
+{
+  const KEY & operator()(const KEY & k) const
+  {
+    return k;
+  }
+};
+
+//value_type is pair<const KEY,VAL>, as for std::map
+template <class KEY, class VAL, class H = tr1::hash<KEY> >
+class FlatHashMap
+    : public FlatHashTable<KEY, pair<const KEY,VAL>, FlatFirst, H>
+{
+public:
+  typedef VAL mapped_type;
+
+  VAL & operator[](const KEY & key)
+  {
+    return this->insert(make_pair(key, VAL())).first->second;
+  }
+};
+
+template <class KEY, class H = tr1::hash<KEY> >
+class FlatHashSet
+    : public FlatHashTable<KEY, KEY, FlatIdentity<KEY>, H>
+{
+};
+
+template <class KEY, class VAL, class H>
+void swap(FlatHashMap<KEY,VAL,H> & a, FlatHashMap<KEY,VAL,H> & b)
+{
+  a.swap(b);
+}
+
+template <class KEY, class H>
+void swap(FlatHashSet<KEY,H> & a, FlatHashSet<KEY,H> & b)
+{
+  a.swap(b);
+}
+
+}
+
+#endif
@@ -0,0 +1,154 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cassert>
+#include <cmath>
+
+#include <Eigen/Geometry>
+
+#include <sophus/se3.h>
+#include <sophus/sim3.h>
+
+#include "gl_line_batch.h"
+#include "draw3d.h"
+
+namespace VisionTools
+{
+GlLineBatch
+::GlLineBatch(bool with_color)
+  : with_color_(with_color),
+    color_(1.f, 1.f, 1.f, 1.f)
+{
+}
+
+void GlLineBatch
+::line(const Vector3d & p1, const Vector3d & p2)
+{
+  addVertex(p1);
+  addVertex(p2);
+}
+
+//In the image space, the center of the first pixel is denoted by (0,0)
+//whereas the position of the top left corner of the first pixel is
+//actually (-0.5,-0.5).
+void GlLineBatch
+::line(const Vector2d & p1, const Vector2d & p2)
+{
+  addVertex(Vector3d(p1[0]+0.5, p1[1]+0.5, 0.));
+  addVertex(Vector3d(p2[0]+0.5, p2[1]+0.5, 0.));
+}
+
+void GlLineBatch
+::box(const cv::Rect_<double> & r)
+{
+  Vector2d v1(r.x, r.y);
+  Vector2d v2(r.x+r.width, r.y+r.height);
+  line(Vector2d(v1[0], v1[1]), Vector2d(v1[0], v2[1]));
+  line(Vector2d(v1[0], v2[1]), Vector2d(v2[0], v2[1]));
+  line(Vector2d(v2[0], v2[1]), Vector2d(v2[0], v1[1]));
+  line(Vector2d(v2[0], v1[1]), Vector2d(v1[0], v1[1]));
+}
+
+void GlLineBatch
+::circle(const Vector2d & center, double radius, int slices)
+{
+  Vector2d prev = center + Vector2d(radius, 0.);
+  for (int i=1; i<=slices; ++i)
+  {
+    double phi = 2.*M_PI*i/slices;
+    Vector2d next = center + radius*Vector2d(std::cos(phi), std::sin(phi));
+    line(prev, next);
+    prev = next;
+  }
+}
+
+//coordinate axes plus a square in the image plane, as Draw3d::pose
+void GlLineBatch
+::poseGlyph(const Matrix3d & R, const Vector3d & t,
+            double axis_size, double half_size)
+{
+  double s = axis_size;
+  double h = half_size;
+  line(t, R*Vector3d(s,0,0)+t);
+  line(t, R*Vector3d(0,s,0)+t);
+  line(t, R*Vector3d(0,0,s)+t);
+  Vector3d c1 = R*Vector3d( h, h,0)+t;
+  Vector3d c2 = R*Vector3d(-h, h,0)+t;
+  Vector3d c3 = R*Vector3d(-h,-h,0)+t;
+  Vector3d c4 = R*Vector3d( h,-h,0)+t;
+  line(c1, c2);
+  line(c3, c2);
+  line(c3, c4);
+  line(c1, c4);
+}
+
+void GlLineBatch
+::pose(const SE3 & T_world_from_cam, double size)
+{
+  Matrix4d T = T_world_from_cam.matrix();
+  poseGlyph(T.topLeftCorner<3,3>(), T.topRightCorner<3,1>(),
+            size, size*0.5);
+}
+
+void GlLineBatch
+::pose(const Sim3 & T_world_from_cam, double size)
+{
+  Vector4d axis_angle_scale = T_world_from_cam.scso3().log();
+  Vector3d axis_angle = axis_angle_scale.head<3>();
+  double angle = axis_angle.norm();
+  Matrix3d R = Matrix3d::Identity();
+  if (angle!=0.)
+  {
+    R = AngleAxisd(angle, axis_angle/angle).toRotationMatrix();
+  }
+  poseGlyph(R, T_world_from_cam.translation(),
+            size, axis_angle_scale[3]*size*0.5);
+}
+
+void GlLineBatch
+::flush()
+{
+  if (xyz_.empty())
+    return;
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(3, GL_FLOAT, 0, &(xyz_[0].x));
+  if (with_color_)
+  {
+    glEnableClientState(GL_COLOR_ARRAY);
+    glColorPointer(4, GL_FLOAT, 0, &(colors_[0].x));
+  }
+  glDrawArrays(GL_LINES, 0, xyz_.size());
+  if (with_color_)
+    glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  clear();
+  assert(Draw3d::checkForGlError());
+}
+
+void GlLineBatch
+::clear()
+{
+  xyz_.clear();
+  colors_.clear();
+}
+
+}
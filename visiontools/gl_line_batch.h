@@ -0,0 +1,110 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_GL_LINE_BATCH_H
+#define VISIONTOOLS_GL_LINE_BATCH_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "gl_data.h"
+
+namespace Sophus
+{
+class SE3;
+class Sim3;
+}
+
+namespace VisionTools
+{
+using namespace Sophus;
+
+//Records line primitives into one vertex array and draws all of them with
+//a single glDrawArrays(GL_LINES) call in flush(). 2d primitives take pixel
+//coordinates (as Draw2d) and lie in the z=0 plane. Without per-vertex
+//colors, the current GL color at flush time is used.
+class GlLineBatch
+{
+public:
+  explicit
+  GlLineBatch                (bool with_color = true);
+
+  //color of all primitives added from now on
+  void set_color(const Vector4f & color)
+  {
+    color_ = GlPoint4f(color[0], color[1], color[2], color[3]);
+  }
+
+  void
+  line                       (const Vector3d & p1,
+                              const Vector3d & p2);
+  void
+  line                       (const Vector2d & p1,
+                              const Vector2d & p2);
+  void
+  box                        (const cv::Rect_<double> & r);
+  void
+  circle                     (const Vector2d & center,
+                              double radius,
+                              int slices = 20);
+  void
+  pose                       (const SE3 & T_world_from_cam,
+                              double size = 0.1);
+  void
+  pose                       (const Sim3 & T_world_from_cam,
+                              double size = 0.1);
+
+  //draws and clears the batch, with the current GL line width
+  void
+  flush                      ();
+  void
+  clear                      ();
+
+  int num_lines() const
+  {
+    return xyz_.size()/2;
+  }
+
+private:
+  void addVertex(const Vector3d & p)
+  {
+    xyz_.push_back(GlPoint3f(p[0], p[1], p[2]));
+    if (with_color_)
+      colors_.push_back(color_);
+  }
+
+  void
+  poseGlyph                  (const Matrix3d & R,
+                              const Vector3d & t,
+                              double axis_size,
+                              double half_size);
+
+  bool with_color_;
+  GlPoint4f color_;
+  vector<GlPoint3f> xyz_;
+  vector<GlPoint4f> colors_;
+};
+
+}
+
+#endif
@@ -0,0 +1,423 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#ifdef VISIONTOOLS_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "gl_offscreen.h"
+#include "draw2d.h"
+
+namespace VisionTools
+{
+GlOffscreenContext
+::GlOffscreenContext()
+  : display_(NULL),
+    surface_(NULL),
+    context_(NULL)
+{
+}
+
+GlOffscreenContext
+::~GlOffscreenContext()
+{
+  release();
+}
+
+#ifdef VISIONTOOLS_HAVE_EGL
+#ifndef EGL_PLATFORM_DEVICE_EXT
+#define EGL_PLATFORM_DEVICE_EXT 0x313F
+#endif
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace
+{
+typedef EGLDisplay (*GetPlatformDisplayProc)(EGLenum, void *, const EGLint *);
+typedef EGLBoolean (*QueryDevicesProc)(EGLint, void **, EGLint *);
+
+bool hasExtension(const char * extensions, const char * name)
+{
+  if (extensions==NULL)
+    return false;
+  size_t len = strlen(name);
+  for (const char * p=strstr(extensions, name); p!=NULL;
+       p=strstr(p+len, name))
+  {
+    if ((p==extensions || p[-1]==' ') && (p[len]==' ' || p[len]=='\0'))
+      return true;
+  }
+  return false;
+}
+
+EGLDisplay initializedDisplay(EGLDisplay display)
+{
+  if (display!=EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+    return display;
+  return EGL_NO_DISPLAY;
+}
+
+//EGL_DEFAULT_DISPLAY lets Mesa pick its X11 or Wayland platform, which
+//fails without a display server. Prefer a platform that needs none: a
+//GPU device (EGL_EXT_platform_device), then Mesa's surfaceless platform.
+EGLDisplay headlessDisplay()
+{
+  const char * client_ext = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  GetPlatformDisplayProc get_platform_display
+      = reinterpret_cast<GetPlatformDisplayProc>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (get_platform_display!=NULL)
+  {
+    QueryDevicesProc query_devices = reinterpret_cast<QueryDevicesProc>(
+        eglGetProcAddress("eglQueryDevicesEXT"));
+    if (hasExtension(client_ext, "EGL_EXT_platform_device")
+        && query_devices!=NULL)
+    {
+      const EGLint MAX_DEVICES = 16;
+      void * devices[MAX_DEVICES];
+      EGLint num_devices = 0;
+      if (query_devices(MAX_DEVICES, devices, &num_devices))
+      {
+        for (EGLint i=0; i<num_devices; ++i)
+        {
+          EGLDisplay display = initializedDisplay(
+              get_platform_display(EGL_PLATFORM_DEVICE_EXT, devices[i], NULL));
+          if (display!=EGL_NO_DISPLAY)
+            return display;
+        }
+      }
+    }
+    if (hasExtension(client_ext, "EGL_MESA_platform_surfaceless"))
+    {
+      EGLDisplay display = initializedDisplay(
+          get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                               EGL_DEFAULT_DISPLAY, NULL));
+      if (display!=EGL_NO_DISPLAY)
+        return display;
+    }
+  }
+  return initializedDisplay(eglGetDisplay(EGL_DEFAULT_DISPLAY));
+}
+}
+
+bool GlOffscreenContext
+::init()
+{
+  if (is_valid())
+    return makeCurrent();
+  EGLDisplay display = headlessDisplay();
+  if (display==EGL_NO_DISPLAY)
+  {
+    cerr << "GlOffscreenContext: no EGL display" << endl;
+    return false;
+  }
+  display_ = display;
+  const EGLint config_attribs[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_DEPTH_SIZE, 24,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint num_configs;
+  if (!eglChooseConfig(display, config_attribs, &config, 1, &num_configs)
+      || num_configs==0 || !eglBindAPI(EGL_OPENGL_API))
+  {
+    cerr << "GlOffscreenContext: no suitable EGL config" << endl;
+    release();
+    return false;
+  }
+  //all drawing goes to framebuffer objects, the surface only has to exist
+  const EGLint pbuffer_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+  surface_ = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+  context_ = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+  if (surface_==EGL_NO_SURFACE || context_==EGL_NO_CONTEXT)
+  {
+    cerr << "GlOffscreenContext: cannot create EGL context" << endl;
+    release();
+    return false;
+  }
+  if (!makeCurrent())
+  {
+    release();
+    return false;
+  }
+  glewExperimental = GL_TRUE;
+  GLenum glew_error = glewInit();
+  glGetError();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+  //GLEW built for GLX loads the GL entry points first and only then fails
+  //to find a GLX display. That is fine as long as they did resolve, which
+  //depends on the GL library (e.g. libglvnd dispatches to EGL contexts).
+  if (glew_error==GLEW_ERROR_NO_GLX_DISPLAY && glGenBuffers!=NULL
+      && glGenRenderbuffers!=NULL)
+    glew_error = GLEW_OK;
+#endif
+  if (glew_error!=GLEW_OK)
+  {
+    cerr << "GlOffscreenContext: glewInit failed: "
+         << glewGetErrorString(glew_error) << endl;
+    release();
+    return false;
+  }
+  return true;
+}
+
+bool GlOffscreenContext
+::makeCurrent()
+{
+  if (!is_valid())
+    return false;
+  return eglMakeCurrent(display_, surface_, surface_, context_)==EGL_TRUE;
+}
+
+void GlOffscreenContext
+::release()
+{
+  if (display_==NULL)
+    return;
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (context_!=NULL)
+    eglDestroyContext(display_, context_);
+  if (surface_!=NULL)
+    eglDestroySurface(display_, surface_);
+  eglTerminate(display_);
+  display_ = NULL;
+  surface_ = NULL;
+  context_ = NULL;
+}
+#else
+bool GlOffscreenContext
+::init()
+{
+  cerr << "GlOffscreenContext: VisionTools was built without EGL" << endl;
+  return false;
+}
+
+bool GlOffscreenContext
+::makeCurrent()
+{
+  return false;
+}
+
+void GlOffscreenContext
+::release()
+{
+}
+#endif
+
+GlFramebuffer
+::GlFramebuffer(const cv::Size & size)
+  : size_(size),
+    fbo_(0),
+    color_rbo_(0),
+    depth_rbo_(0),
+    next_pbo_(0),
+    num_pending_(0),
+    prev_fbo_(0)
+{
+  pbo_[0] = 0;
+  pbo_[1] = 0;
+}
+
+GlFramebuffer
+::~GlFramebuffer()
+{
+  release();
+}
+
+bool GlFramebuffer
+::init()
+{
+  if (fbo_!=0)
+    return true;
+  if (!GLEW_VERSION_3_0 && !GLEW_ARB_framebuffer_object)
+  {
+    cerr << "GlFramebuffer: framebuffer objects not supported" << endl;
+    return false;
+  }
+  glGenRenderbuffers(1, &color_rbo_);
+  glBindRenderbuffer(GL_RENDERBUFFER, color_rbo_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8,
+                        size_.width, size_.height);
+  glGenRenderbuffers(1, &depth_rbo_);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_rbo_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
+                        size_.width, size_.height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  GLint prev_fbo;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev_fbo);
+  glGenFramebuffers(1, &fbo_);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, color_rbo_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth_rbo_);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, prev_fbo);
+  if (status!=GL_FRAMEBUFFER_COMPLETE)
+  {
+    cerr << "GlFramebuffer: incomplete framebuffer" << endl;
+    release();
+    return false;
+  }
+  if (GLEW_ARB_pixel_buffer_object)
+  {
+    GLint prev_pbo;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &prev_pbo);
+    glGenBuffers(2, pbo_);
+    for (int i=0; i<2; ++i)
+    {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[i]);
+      glBufferData(GL_PIXEL_PACK_BUFFER, 3*size_.width*size_.height, NULL,
+                   GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, prev_pbo);
+  }
+  assert(Draw2d::checkForGlError());
+  return true;
+}
+
+void GlFramebuffer
+::bind()
+{
+  assert(fbo_!=0);
+  glGetIntegerv(GL_VIEWPORT, prev_viewport_);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev_fbo_);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+  glViewport(0, 0, size_.width, size_.height);
+}
+
+void GlFramebuffer
+::unbind()
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, prev_fbo_);
+  glViewport(prev_viewport_[0], prev_viewport_[1],
+             prev_viewport_[2], prev_viewport_[3]);
+}
+
+void GlFramebuffer
+::release()
+{
+  if (fbo_!=0)
+    glDeleteFramebuffers(1, &fbo_);
+  if (color_rbo_!=0)
+    glDeleteRenderbuffers(1, &color_rbo_);
+  if (depth_rbo_!=0)
+    glDeleteRenderbuffers(1, &depth_rbo_);
+  if (pbo_[0]!=0)
+    glDeleteBuffers(2, pbo_);
+  fbo_ = 0;
+  color_rbo_ = 0;
+  depth_rbo_ = 0;
+  pbo_[0] = 0;
+  pbo_[1] = 0;
+  next_pbo_ = 0;
+  num_pending_ = 0;
+}
+
+//GL stores the bottom row first
+void GlFramebuffer
+::copyFlipped(const unsigned char * src, cv::Mat * img) const
+{
+  img->create(size_, CV_8UC3);
+  size_t row_bytes = 3*size_.width;
+  for (int r=0; r<size_.height; ++r)
+  {
+    memcpy(img->ptr(r), src+(size_.height-1-r)*row_bytes, row_bytes);
+  }
+}
+
+void GlFramebuffer
+::read(cv::Mat * img)
+{
+  vector<unsigned char> buffer(3*size_.width*size_.height);
+  GLint prev_fbo;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+  //tightly packed rows; the caller's pack state is left untouched
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, size_.width, size_.height, GL_BGR, GL_UNSIGNED_BYTE,
+               &buffer[0]);
+  glPopClientAttrib();
+  glBindFramebuffer(GL_FRAMEBUFFER, prev_fbo);
+  copyFlipped(&buffer[0], img);
+  assert(Draw2d::checkForGlError());
+}
+
+bool GlFramebuffer
+::requestRead()
+{
+  if (pbo_[0]==0 || num_pending_==2)
+    return false;
+  GLint prev_fbo, prev_pbo;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev_fbo);
+  glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &prev_pbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[next_pbo_]);
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, size_.width, size_.height, GL_BGR, GL_UNSIGNED_BYTE, 0);
+  glPopClientAttrib();
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, prev_pbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, prev_fbo);
+  next_pbo_ = 1-next_pbo_;
+  ++num_pending_;
+  assert(Draw2d::checkForGlError());
+  return true;
+}
+
+bool GlFramebuffer
+::fetch(cv::Mat * img)
+{
+  if (num_pending_==0)
+    return false;
+  int oldest = num_pending_==2 ? next_pbo_ : 1-next_pbo_;
+  GLint prev_pbo;
+  glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &prev_pbo);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[oldest]);
+  const unsigned char * src = static_cast<const unsigned char *>(
+        glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+  bool ok = src!=NULL;
+  if (ok)
+  {
+    copyFlipped(src, img);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, prev_pbo);
+  --num_pending_;
+  assert(Draw2d::checkForGlError());
+  return ok;
+}
+
+}
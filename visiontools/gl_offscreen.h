@@ -0,0 +1,123 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_GL_OFFSCREEN_H
+#define VISIONTOOLS_GL_OFFSCREEN_H
+
+#include <opencv2/core/core.hpp>
+
+#include "gl_data.h"
+
+namespace VisionTools
+{
+
+//GL context without any window, through EGL (e.g. Mesa's surfaceless or
+//software drivers). Only available if VisionTools was built with EGL;
+//otherwise init() fails.
+class GlOffscreenContext
+{
+public:
+  GlOffscreenContext         ();
+  ~GlOffscreenContext        ();
+
+  bool                       //creates the context and makes it current
+  init                       ();
+  bool
+  makeCurrent                ();
+  void
+  release                    ();
+
+  bool is_valid() const
+  {
+    return context_!=NULL;
+  }
+
+private:
+  GlOffscreenContext(const GlOffscreenContext &);
+  GlOffscreenContext & operator=(const GlOffscreenContext &);
+
+  void * display_;
+  void * surface_;
+  void * context_;
+};
+
+//Render target for Draw2d/Draw3d: bind(), then activate and draw as usual;
+//unbind() restores the framebuffer and viewport that were bound before.
+//the image is read back as CV_8UC3 (BGR, top row first, as on screen).
+//Besides the blocking read(), requestRead() starts a transfer into one of
+//two pixel buffer objects, which fetch() later maps without stalling the
+//pipeline.
+class GlFramebuffer
+{
+public:
+  explicit
+  GlFramebuffer              (const cv::Size & size);
+  ~GlFramebuffer             ();
+
+  bool                       //needs a current context
+  init                       ();
+  void                       //also sets the viewport
+  bind                       ();
+  void
+  unbind                     ();
+  void
+  release                    ();
+
+  void
+  read                       (cv::Mat * img);
+  bool                       //false if two reads are pending already
+  requestRead                ();
+  bool                       //oldest pending read; false if there is none
+  fetch                      (cv::Mat * img);
+
+  int num_pending() const
+  {
+    return num_pending_;
+  }
+
+  const cv::Size & size() const
+  {
+    return size_;
+  }
+
+private:
+  GlFramebuffer(const GlFramebuffer &);
+  GlFramebuffer & operator=(const GlFramebuffer &);
+
+  void
+  copyFlipped                (const unsigned char * src,
+                              cv::Mat * img) const;
+
+  cv::Size size_;
+  GLuint fbo_;
+  GLuint color_rbo_;
+  GLuint depth_rbo_;
+  GLuint pbo_[2];
+  int next_pbo_;
+  int num_pending_;
+  GLint prev_viewport_[4];
+  GLint prev_fbo_;
+};
+
+}
+
+#endif
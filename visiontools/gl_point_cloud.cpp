@@ -0,0 +1,295 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cassert>
+
+#include <sophus/se3.h>
+
+#include "gl_point_cloud.h"
+#include "draw3d.h"
+
+namespace VisionTools
+{
+GlPointCloud
+::GlPointCloud(bool with_color, Layout layout)
+  : with_color_(with_color),
+    layout_(layout),
+    size_(0),
+    capacity_(0),
+    xyz_vbo_(0),
+    color_vbo_(0)
+{
+}
+
+GlPointCloud
+::~GlPointCloud()
+{
+  release();
+}
+
+int GlPointCloud
+::vertexBytes() const
+{
+  if (with_color_ && layout_==INTERLEAVED)
+  {
+    return sizeof(GlPoint3f)+sizeof(GlPoint4f);
+  }
+  return sizeof(GlPoint3f);
+}
+
+void GlPointCloud
+::reserve(int capacity)
+{
+  if (capacity<=capacity_)
+    return;
+  if (xyz_vbo_==0)
+  {
+    glGenBuffers(1, &xyz_vbo_);
+    if (with_color_ && layout_==SEPARATE)
+      glGenBuffers(1, &color_vbo_);
+  }
+  resizeBuffer(xyz_vbo_, vertexBytes(), capacity);
+  if (color_vbo_!=0)
+    resizeBuffer(color_vbo_, sizeof(GlPoint4f), capacity);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  capacity_ = capacity;
+  assert(Draw3d::checkForGlError());
+}
+
+//Reallocates the buffer storage and restores the first size_ elements. The
+//round trip through host memory only needs GL 1.5 and is amortised by
+//geometric growth in append().
+void GlPointCloud
+::resizeBuffer(GLuint vbo, int elem_bytes, int new_capacity)
+{
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  vector<char> old_data;
+  if (size_>0)
+  {
+    old_data.resize(static_cast<size_t>(size_)*elem_bytes);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, old_data.size(), &old_data[0]);
+  }
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(new_capacity)*elem_bytes,
+               NULL, GL_STATIC_DRAW);
+  if (size_>0)
+  {
+    glBufferSubData(GL_ARRAY_BUFFER, 0, old_data.size(), &old_data[0]);
+  }
+}
+
+void GlPointCloud
+::grow(int min_capacity)
+{
+  if (min_capacity<=capacity_)
+    return;
+  reserve(std::max(min_capacity, 2*capacity_));
+}
+
+void GlPointCloud
+::upload(int offset, const GlPoint3f * xyz, const GlPoint4f * color, int num)
+{
+  if (num==0)
+    return;
+  if (with_color_ && layout_==INTERLEAVED)
+  {
+    assert(xyz!=NULL && color!=NULL);
+    vector<GLfloat> interleaved(7*num);
+    for (int i=0; i<num; ++i)
+    {
+      GLfloat * v = &interleaved[7*i];
+      v[0] = xyz[i].x; v[1] = xyz[i].y; v[2] = xyz[i].z;
+      v[3] = color[i].x; v[4] = color[i].y; v[5] = color[i].z;
+      v[6] = color[i].w;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, xyz_vbo_);
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    static_cast<GLintptr>(offset)*vertexBytes(),
+                    interleaved.size()*sizeof(GLfloat), &interleaved[0]);
+  }
+  else
+  {
+    if (xyz!=NULL)
+    {
+      glBindBuffer(GL_ARRAY_BUFFER, xyz_vbo_);
+      glBufferSubData(GL_ARRAY_BUFFER,
+                      static_cast<GLintptr>(offset)*sizeof(GlPoint3f),
+                      num*sizeof(GlPoint3f), xyz);
+    }
+    if (color!=NULL)
+    {
+      glBindBuffer(GL_ARRAY_BUFFER, color_vbo_);
+      glBufferSubData(GL_ARRAY_BUFFER,
+                      static_cast<GLintptr>(offset)*sizeof(GlPoint4f),
+                      num*sizeof(GlPoint4f), color);
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  assert(Draw3d::checkForGlError());
+}
+
+void GlPointCloud
+::append(const vector<GlPoint3f> & xyz)
+{
+  assert(!with_color_);
+  if (xyz.empty())
+    return;
+  grow(size_+xyz.size());
+  upload(size_, &xyz[0], NULL, xyz.size());
+  size_ += xyz.size();
+}
+
+void GlPointCloud
+::append(const vector<GlPoint3f> & xyz,
+         const vector<GlPoint4f> & color)
+{
+  assert(with_color_);
+  assert(xyz.size()==color.size());
+  if (xyz.empty())
+    return;
+  grow(size_+xyz.size());
+  upload(size_, &xyz[0], &color[0], xyz.size());
+  size_ += xyz.size();
+}
+
+void GlPointCloud
+::update(int offset, const vector<GlPoint3f> & xyz)
+{
+  assert(!with_color_ || layout_==SEPARATE);
+  assert(offset>=0 && offset+static_cast<int>(xyz.size())<=size_);
+  if (xyz.empty())
+    return;
+  upload(offset, &xyz[0], NULL, xyz.size());
+}
+
+void GlPointCloud
+::update(int offset,
+         const vector<GlPoint3f> & xyz,
+         const vector<GlPoint4f> & color)
+{
+  assert(with_color_);
+  assert(xyz.size()==color.size());
+  assert(offset>=0 && offset+static_cast<int>(xyz.size())<=size_);
+  if (xyz.empty())
+    return;
+  upload(offset, &xyz[0], &color[0], xyz.size());
+}
+
+void GlPointCloud
+::updateColors(int offset, const vector<GlPoint4f> & color)
+{
+  assert(with_color_ && layout_==SEPARATE);
+  assert(offset>=0 && offset+static_cast<int>(color.size())<=size_);
+  if (color.empty())
+    return;
+  upload(offset, NULL, &color[0], color.size());
+}
+
+void GlPointCloud
+::clear()
+{
+  size_ = 0;
+}
+
+void GlPointCloud
+::release()
+{
+  if (xyz_vbo_!=0)
+    glDeleteBuffers(1, &xyz_vbo_);
+  if (color_vbo_!=0)
+    glDeleteBuffers(1, &color_vbo_);
+  xyz_vbo_ = 0;
+  color_vbo_ = 0;
+  size_ = 0;
+  capacity_ = 0;
+}
+
+void GlPointCloud
+::draw(const SE3 & T_world_from_here, double pixel_size) const
+{
+  glPushMatrix();
+  Matrix<double,4,4,ColMajor> Topengl_world_from_here
+      = T_world_from_here.matrix();
+  glMultMatrixd(Topengl_world_from_here.data());
+  draw(pixel_size);
+  glPopMatrix();
+}
+
+void GlPointCloud
+::draw(double pixel_size) const
+{
+  if (size_==0)
+    return;
+  bindArrays(pixel_size);
+  glDrawArrays(GL_POINTS, 0, size_);
+  unbindArrays();
+}
+
+void GlPointCloud
+::drawRanges(const GLint * first, const GLsizei * count, int num_ranges,
+             double pixel_size) const
+{
+  if (num_ranges==0)
+    return;
+  bindArrays(pixel_size);
+  glMultiDrawArrays(GL_POINTS, first, count, num_ranges);
+  unbindArrays();
+}
+
+void GlPointCloud
+::bindArrays(double pixel_size) const
+{
+  glEnable(GL_POINT_SMOOTH);
+  glPointSize(pixel_size);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glBindBuffer(GL_ARRAY_BUFFER, xyz_vbo_);
+  glVertexPointer(3, GL_FLOAT, vertexBytes(), 0);
+  if (with_color_)
+  {
+    glEnableClientState(GL_COLOR_ARRAY);
+    if (layout_==INTERLEAVED)
+    {
+      glColorPointer(4, GL_FLOAT, vertexBytes(),
+                     reinterpret_cast<const GLvoid *>(sizeof(GlPoint3f)));
+    }
+    else
+    {
+      glBindBuffer(GL_ARRAY_BUFFER, color_vbo_);
+      glColorPointer(4, GL_FLOAT, 0, 0);
+    }
+  }
+}
+
+//leave client arrays in the state the Draw3d functions expect
+void GlPointCloud
+::unbindArrays() const
+{
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  if (with_color_)
+    glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glDisable(GL_POINT_SMOOTH);
+  assert(Draw3d::checkForGlError());
+}
+
+}
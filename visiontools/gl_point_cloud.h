@@ -0,0 +1,148 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_GL_POINT_CLOUD_H
+#define VISIONTOOLS_GL_POINT_CLOUD_H
+
+#include <vector>
+
+#include "gl_data.h"
+
+namespace Sophus
+{
+class SE3;
+}
+
+namespace VisionTools
+{
+using namespace Sophus;
+
+//Point cloud which lives in vertex buffer objects on the GPU. Points are
+//uploaded once and drawn with a single glDrawArrays call; append() and
+//update() only transfer the given range. Needs a current GL context for
+//everything but the constructor (VBOs are core since OpenGL 1.5, so Mesa's
+//software renderers work as well).
+class GlPointCloud
+{
+public:
+  enum Layout
+  {
+    INTERLEAVED,  //one buffer of xyzrgba, single stream when drawing
+    SEPARATE      //one buffer per attribute, colors can be updated alone
+  };
+
+  explicit
+  GlPointCloud               (bool with_color = false,
+                              Layout layout = INTERLEAVED);
+  ~GlPointCloud              ();
+
+  void
+  reserve                    (int capacity);
+  void
+  append                     (const vector<GlPoint3f> & xyz);
+  void
+  append                     (const vector<GlPoint3f> & xyz,
+                              const vector<GlPoint4f> & color);
+  //overwrites points [offset, offset+xyz.size()), which must exist already;
+  //position-only updates of colored clouds need the SEPARATE layout
+  void
+  update                     (int offset,
+                              const vector<GlPoint3f> & xyz);
+  void
+  update                     (int offset,
+                              const vector<GlPoint3f> & xyz,
+                              const vector<GlPoint4f> & color);
+  void
+  updateColors               (int offset,
+                              const vector<GlPoint4f> & color);
+  //keeps the GPU memory, use release() to free it
+  void
+  clear                      ();
+  void
+  release                    ();
+
+  void
+  draw                       (double pixel_size) const;
+  void
+  draw                       (const SE3 & T_world_from_here,
+                              double pixel_size) const;
+  //points [first[i], first[i]+count[i]) for all i, in one glMultiDrawArrays
+  void
+  drawRanges                 (const GLint * first,
+                              const GLsizei * count,
+                              int num_ranges,
+                              double pixel_size) const;
+
+  int size() const
+  {
+    return size_;
+  }
+
+  int capacity() const
+  {
+    return capacity_;
+  }
+
+  bool with_color() const
+  {
+    return with_color_;
+  }
+
+  Layout layout() const
+  {
+    return layout_;
+  }
+
+private:
+  GlPointCloud(const GlPointCloud &);
+  GlPointCloud & operator=(const GlPointCloud &);
+
+  void
+  grow                       (int min_capacity);
+  void
+  upload                     (int offset,
+                              const GlPoint3f * xyz,
+                              const GlPoint4f * color,
+                              int num);
+  void
+  resizeBuffer               (GLuint vbo,
+                              int elem_bytes,
+                              int new_capacity);
+
+  void
+  bindArrays                 (double pixel_size) const;
+  void
+  unbindArrays               () const;
+  int
+  vertexBytes                () const;
+
+  bool with_color_;
+  Layout layout_;
+  int size_;
+  int capacity_;
+  GLuint xyz_vbo_;
+  GLuint color_vbo_;
+};
+
+}
+
+#endif
@@ -0,0 +1,352 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <sophus/se3.h>
+
+#include "gl_point_cloud_lod.h"
+#include "sample.h"
+
+namespace VisionTools
+{
+namespace
+{
+//near and far plane as used by Draw3d::activate
+const double NEAR_PLANE = 0.1;
+const double FAR_PLANE = 1000.;
+//cell coordinates per axis in a Morton code
+const int MORTON_BITS = 21;
+//subtrees with at most this many points are not split further, so that
+//every drawn range has some length
+const int MAX_LEAF_POINTS = 1024;
+
+//inserts two zero bits above each of the lowest 21 bits
+uint64_t spreadBits(uint64_t x)
+{
+  x &= (1ull<<MORTON_BITS)-1;
+  x = (x | x<<32) & 0x1f00000000ffffull;
+  x = (x | x<<16) & 0x1f0000ff0000ffull;
+  x = (x | x<<8) & 0x100f00f00f00f00full;
+  x = (x | x<<4) & 0x10c30c30c30c30c3ull;
+  x = (x | x<<2) & 0x1249249249249249ull;
+  return x;
+}
+
+struct KeyLess
+{
+  KeyLess(const vector<uint64_t> & keys) : keys(keys) {}
+
+  bool operator()(int i, int j) const
+  {
+    return keys[i]<keys[j];
+  }
+
+  const vector<uint64_t> & keys;
+};
+
+//shuffles [first, end) so that each prefix is a uniform sample
+void shuffle(int first, int end, RandomEngine * rng, vector<int> * order)
+{
+  for (int i=first; i<end-1; ++i)
+  {
+    std::swap((*order)[i], (*order)[rng->uniform(i, end-1)]);
+  }
+}
+}
+
+GlPointCloudLod
+::GlPointCloudLod(double cell_size, bool with_color)
+  : cell_size_(cell_size),
+    cloud_(with_color, GlPointCloud::INTERLEAVED)
+{
+}
+
+//Sorts the points by the Morton code of their voxel, so that every octree
+//subtree is a contiguous range, and shuffles each voxel's range. The
+//samples of the inner nodes are appended to order after the n points.
+//A fixed seed makes rebuilding the same cloud give the same levels of
+//detail.
+void GlPointCloudLod
+::buildNodes(const vector<GlPoint3f> & xyz, vector<int> * order)
+{
+  nodes_.clear();
+  order->clear();
+  int n = xyz.size();
+  if (n==0)
+    return;
+  vector<int64_t> cells(3*n);
+  double inv_cell = 1./cell_size_;
+  for (int i=0; i<n; ++i)
+  {
+    cells[3*i] = static_cast<int64_t>(std::floor(xyz[i].x*inv_cell));
+    cells[3*i+1] = static_cast<int64_t>(std::floor(xyz[i].y*inv_cell));
+    cells[3*i+2] = static_cast<int64_t>(std::floor(xyz[i].z*inv_cell));
+  }
+  int64_t min_cell[3] = {cells[0], cells[1], cells[2]};
+  for (int i=1; i<n; ++i)
+  {
+    for (int d=0; d<3; ++d)
+      min_cell[d] = std::min(min_cell[d], cells[3*i+d]);
+  }
+  vector<uint64_t> keys(n);
+  for (int i=0; i<n; ++i)
+  {
+    uint64_t key = 0;
+    for (int d=0; d<3; ++d)
+    {
+      int64_t c = cells[3*i+d]-min_cell[d];
+      assert(c < (int64_t(1)<<MORTON_BITS)
+             && "GlPointCloudLod: cloud too large for cell size");
+      key |= spreadBits(c) << (2-d);
+    }
+    keys[i] = key;
+  }
+  order->resize(n);
+  for (int i=0; i<n; ++i)
+  {
+    (*order)[i] = i;
+  }
+  std::sort(order->begin(), order->end(), KeyLess(keys));
+
+  vector<uint64_t> voxel_codes;
+  vector<int> voxel_firsts;
+  for (int i=0; i<n; ++i)
+  {
+    if (i==0 || keys[(*order)[i]]!=voxel_codes.back())
+    {
+      voxel_codes.push_back(keys[(*order)[i]]);
+      voxel_firsts.push_back(i);
+    }
+  }
+  voxel_firsts.push_back(n);
+
+  RandomEngine rng(0);
+  Vector3d min_corner, max_corner;
+  nodes_.resize(1);
+  buildSubtree(0, 0, voxel_codes.size(), voxel_codes, voxel_firsts, xyz, &rng,
+               order, &min_corner, &max_corner);
+}
+
+//Splits the voxels at the highest octree level where their codes differ,
+//which skips levels with a single child.
+void GlPointCloudLod
+::buildSubtree(int id, int first_voxel, int end_voxel,
+               const vector<uint64_t> & voxel_codes,
+               const vector<int> & voxel_firsts,
+               const vector<GlPoint3f> & xyz,
+               RandomEngine * rng,
+               vector<int> * order,
+               Vector3d * min_corner,
+               Vector3d * max_corner)
+{
+  int first = voxel_firsts[first_voxel];
+  int end = voxel_firsts[end_voxel];
+  if (end_voxel-first_voxel==1 || end-first<=MAX_LEAF_POINTS)
+  {
+    shuffle(first, end, rng, order);
+    const GlPoint3f & p0 = xyz[(*order)[first]];
+    *min_corner = Vector3d(p0.x, p0.y, p0.z);
+    *max_corner = *min_corner;
+    for (int i=first+1; i<end; ++i)
+    {
+      const GlPoint3f & p = xyz[(*order)[i]];
+      Vector3d v(p.x, p.y, p.z);
+      *min_corner = min_corner->cwiseMin(v);
+      *max_corner = max_corner->cwiseMax(v);
+    }
+    Node & node = nodes_[id];
+    node.first = first;
+    node.count = end-first;
+    node.first_child = 0;
+    node.num_children = 0;
+  }
+  else
+  {
+    //voxels are sorted, so the first and last differ in the highest digit
+    uint64_t diff = voxel_codes[first_voxel] ^ voxel_codes[end_voxel-1];
+    int shift = 0;
+    while (diff>>(shift+3))
+      shift += 3;
+    vector<int> splits(1, first_voxel);
+    for (int l=first_voxel+1; l<end_voxel; ++l)
+    {
+      if ((voxel_codes[l]>>shift)!=(voxel_codes[l-1]>>shift))
+        splits.push_back(l);
+    }
+    splits.push_back(end_voxel);
+    int num_children = splits.size()-1;
+    int first_child = nodes_.size();
+    nodes_.resize(first_child+num_children);
+    int children_count = 0;
+    for (int c=0; c<num_children; ++c)
+    {
+      Vector3d child_min, child_max;
+      buildSubtree(first_child+c, splits[c], splits[c+1], voxel_codes,
+                   voxel_firsts, xyz, rng, order, &child_min, &child_max);
+      children_count += nodes_[first_child+c].count;
+      if (c==0)
+      {
+        *min_corner = child_min;
+        *max_corner = child_max;
+      }
+      else
+      {
+        *min_corner = min_corner->cwiseMin(child_min);
+        *max_corner = max_corner->cwiseMax(child_max);
+      }
+    }
+    //a quarter per level bounds all samples by a third of the points
+    int count = std::max(1, children_count/4);
+    vector<int> ids(count);
+    rng->subset(end-first, count, &ids[0]);
+    int sample_first = order->size();
+    for (int i=0; i<count; ++i)
+    {
+      int index = (*order)[first+ids[i]];
+      order->push_back(index);
+    }
+    shuffle(sample_first, sample_first+count, rng, order);
+    Node & node = nodes_[id];
+    node.first = sample_first;
+    node.count = count;
+    node.first_child = first_child;
+    node.num_children = num_children;
+  }
+  Node & node = nodes_[id];
+  node.center = 0.5*(*min_corner+*max_corner);
+  node.radius = 0.5*(*max_corner-*min_corner).norm();
+  node.num_points = end-first;
+}
+
+void GlPointCloudLod
+::build(const vector<GlPoint3f> & xyz)
+{
+  vector<int> order;
+  buildNodes(xyz, &order);
+  vector<GlPoint3f> sorted_xyz(order.size());
+  for (size_t i=0; i<order.size(); ++i)
+  {
+    sorted_xyz[i] = xyz[order[i]];
+  }
+  cloud_.clear();
+  cloud_.append(sorted_xyz);
+}
+
+void GlPointCloudLod
+::build(const vector<GlPoint3f> & xyz,
+        const vector<GlPoint4f> & color)
+{
+  assert(xyz.size()==color.size());
+  vector<int> order;
+  buildNodes(xyz, &order);
+  vector<GlPoint3f> sorted_xyz(order.size());
+  vector<GlPoint4f> sorted_color(order.size());
+  for (size_t i=0; i<order.size(); ++i)
+  {
+    sorted_xyz[i] = xyz[order[i]];
+    sorted_color[i] = color[order[i]];
+  }
+  cloud_.clear();
+  cloud_.append(sorted_xyz, sorted_color);
+}
+
+//sphere against the frustum planes set up by Draw3d::activate
+bool GlPointCloudLod
+::isVisible(const LinearCamera & cam, const Vector3d & c, double r) const
+{
+  if (c[2]+r<NEAR_PLANE || c[2]-r>FAR_PLANE)
+    return false;
+  double f = cam.focal_length();
+  double px = cam.principal_point()[0]+0.5;
+  double py = cam.principal_point()[1]+0.5;
+  double w = cam.image_size().width;
+  double h = cam.image_size().height;
+  if (f*c[0]+px*c[2] < -r*std::sqrt(f*f+px*px))
+    return false;
+  if ((w-px)*c[2]-f*c[0] < -r*std::sqrt(f*f+(w-px)*(w-px)))
+    return false;
+  if (f*c[1]+py*c[2] < -r*std::sqrt(f*f+py*py))
+    return false;
+  if ((h-py)*c[2]-f*c[1] < -r*std::sqrt(f*f+(h-py)*(h-py)))
+    return false;
+  return true;
+}
+
+//Depth-first from the root: a node is drawn as a prefix of its points if
+//that is dense enough for its projected area, otherwise its children are
+//visited. Neighbouring ranges are merged.
+int GlPointCloudLod
+::draw(const LinearCamera & cam, const SE3 & T_cw, double pixel_size,
+       double points_per_pixel)
+{
+  firsts_.clear();
+  counts_.clear();
+  stack_.clear();
+  if (!nodes_.empty())
+    stack_.push_back(0);
+  int num_drawn = 0;
+  double f = cam.focal_length();
+  while (!stack_.empty())
+  {
+    const Node & node = nodes_[stack_.back()];
+    stack_.pop_back();
+    Vector3d c = T_cw*node.center;
+    if (!isVisible(cam, c, node.radius))
+      continue;
+    double wanted = node.num_points;
+    double z = c[2]-node.radius;
+    if (z>NEAR_PLANE)
+    {
+      double projected_radius = f*node.radius/z;
+      double area = M_PI*projected_radius*projected_radius
+          /(pixel_size*pixel_size);
+      wanted = std::min(wanted, std::ceil(points_per_pixel*area));
+    }
+    if (node.num_children>0 && wanted>node.count)
+    {
+      for (int i=node.num_children-1; i>=0; --i)
+      {
+        stack_.push_back(node.first_child+i);
+      }
+      continue;
+    }
+    int count = std::max(1, std::min(node.count, static_cast<int>(wanted)));
+    if (!firsts_.empty() && firsts_.back()+counts_.back()==node.first)
+      counts_.back() += count;
+    else
+    {
+      firsts_.push_back(node.first);
+      counts_.push_back(count);
+    }
+    num_drawn += count;
+  }
+  if (!firsts_.empty())
+    cloud_.drawRanges(&firsts_[0], &counts_[0], firsts_.size(), pixel_size);
+  return num_drawn;
+}
+
+}
@@ -0,0 +1,118 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_GL_POINT_CLOUD_LOD_H
+#define VISIONTOOLS_GL_POINT_CLOUD_LOD_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "gl_point_cloud.h"
+#include "linear_camera.h"
+
+namespace VisionTools
+{
+class RandomEngine;
+
+//Static point cloud on a voxel grid for maps which are too large to draw
+//every frame. The voxels form an octree (with single-child levels
+//collapsed) whose leaves are single voxels or subtrees of at most about a
+//thousand points; subtrees outside the Draw3d::activate frustum are
+//skipped as a whole. Every node stores its points in random order, so
+//drawing a prefix gives a uniform decimation whose size follows the node's
+//projected area. Inner nodes keep a random sample of a quarter of their
+//children's points, so a distant subtree is drawn as one prefix of that
+//sample without visiting its leaves. All prefixes are drawn with one
+//glMultiDrawArrays call.
+class GlPointCloudLod
+{
+public:
+  explicit
+  GlPointCloudLod            (double cell_size = 1.,
+                              bool with_color = false);
+
+  void
+  build                      (const vector<GlPoint3f> & xyz);
+  void
+  build                      (const vector<GlPoint3f> & xyz,
+                              const vector<GlPoint4f> & color);
+
+  int                        //number of points drawn
+  draw                       (const LinearCamera & cam,
+                              const SE3 & T_cw,
+                              double pixel_size,
+                              double points_per_pixel = 1.);
+
+  int num_nodes() const
+  {
+    return nodes_.size();
+  }
+
+  int size() const
+  {
+    return nodes_.empty() ? 0 : nodes_[0].num_points;
+  }
+
+private:
+  //children are contiguous in nodes_; leaves have no children
+  struct Node
+  {
+    Vector3d center;
+    double radius;
+    int first;
+    int count;
+    int num_points;
+    int first_child;
+    int num_children;
+  };
+
+  void
+  buildNodes                 (const vector<GlPoint3f> & xyz,
+                              vector<int> * order);
+  void
+  buildSubtree               (int id,
+                              int first_voxel,
+                              int end_voxel,
+                              const vector<uint64_t> & voxel_codes,
+                              const vector<int> & voxel_firsts,
+                              const vector<GlPoint3f> & xyz,
+                              RandomEngine * rng,
+                              vector<int> * order,
+                              Vector3d * min_corner,
+                              Vector3d * max_corner);
+  bool
+  isVisible                  (const LinearCamera & cam,
+                              const Vector3d & center_cam,
+                              double radius) const;
+
+  double cell_size_;
+  vector<Node> nodes_;
+  GlPointCloud cloud_;
+  vector<GLint> firsts_;
+  vector<GLsizei> counts_;
+  vector<int> stack_;
+};
+
+}
+
+#endif
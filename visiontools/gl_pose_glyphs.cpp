@@ -0,0 +1,287 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cassert>
+#include <iostream>
+
+#include <sophus/se3.h>
+#include <sophus/sim3.h>
+
+#include "gl_pose_glyphs.h"
+#include "draw3d.h"
+
+namespace VisionTools
+{
+namespace
+{
+const GLuint POSITION_ATTRIB = 0;
+//Occupies four slots, one per column. NVIDIA aliases generic attributes
+//1-7 with conventional ones (3 is gl_Color, read by the shaders), so use
+//8-11, which only alias gl_MultiTexCoord0-3 that are not used here.
+//GL 2.0 guarantees at least 16 attributes.
+const GLuint MATRIX_ATTRIB = 8;
+
+const char * VERTEX_SHADER =
+    "#version 120\n"
+    "attribute vec3 position;\n"
+    "attribute vec4 col0;\n"
+    "attribute vec4 col1;\n"
+    "attribute vec4 col2;\n"
+    "attribute vec4 col3;\n"
+    "void main()\n"
+    "{\n"
+    "  vec4 p = mat4(col0, col1, col2, col3)*vec4(position, 1.);\n"
+    "  gl_Position = gl_ModelViewProjectionMatrix*p;\n"
+    "  gl_FrontColor = gl_Color;\n"
+    "}\n";
+
+const char * FRAGMENT_SHADER =
+    "#version 120\n"
+    "void main()\n"
+    "{\n"
+    "  gl_FragColor = gl_Color;\n"
+    "}\n";
+
+GLuint compileShader(GLenum type, const char * source)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+  GLint ok;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+  if (!ok)
+  {
+    char log[1024];
+    glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+    cerr << "GlPoseGlyphs: shader compilation failed: " << log << endl;
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+//coordinate axes plus a square in the image plane, as Draw3d::pose
+void glyphVertices(double size, GlPoint3f * v)
+{
+  float s = size;
+  float h = size*0.5;
+  v[0] = GlPoint3f(0,0,0);   v[1] = GlPoint3f(s,0,0);
+  v[2] = GlPoint3f(0,0,0);   v[3] = GlPoint3f(0,s,0);
+  v[4] = GlPoint3f(0,0,0);   v[5] = GlPoint3f(0,0,s);
+  v[6] = GlPoint3f(h,h,0);   v[7] = GlPoint3f(-h,h,0);
+  v[8] = GlPoint3f(-h,-h,0); v[9] = GlPoint3f(-h,h,0);
+  v[10] = GlPoint3f(-h,-h,0); v[11] = GlPoint3f(h,-h,0);
+  v[12] = GlPoint3f(h,h,0);  v[13] = GlPoint3f(h,-h,0);
+}
+}
+
+GlPoseGlyphs
+::GlPoseGlyphs(double size)
+  : size_(size),
+    num_(0),
+    instancing_(-1),
+    glyph_(NUM_GLYPH_VERTICES),
+    glyph_vbo_(0),
+    instance_vbo_(0),
+    program_(0)
+{
+  glyphVertices(size_, &glyph_[0]);
+}
+
+GlPoseGlyphs
+::~GlPoseGlyphs()
+{
+  release();
+}
+
+void GlPoseGlyphs
+::set(const SE3 * T_world_from_cam, int num)
+{
+  num_ = num;
+  matrices_.resize(16*num);
+#pragma omp parallel for
+  for (int i=0; i<num; ++i)
+  {
+    Map<Matrix<GLfloat,4,4,ColMajor> > T(&matrices_[16*i]);
+    T = T_world_from_cam[i].matrix().cast<GLfloat>();
+  }
+  upload();
+}
+
+void GlPoseGlyphs
+::set(const Sim3 * T_world_from_cam, int num)
+{
+  num_ = num;
+  matrices_.resize(16*num);
+#pragma omp parallel for
+  for (int i=0; i<num; ++i)
+  {
+    Map<Matrix<GLfloat,4,4,ColMajor> > T(&matrices_[16*i]);
+    T = T_world_from_cam[i].matrix().cast<GLfloat>();
+  }
+  upload();
+}
+
+bool GlPoseGlyphs
+::initInstancing()
+{
+  if (!GLEW_VERSION_2_0 || !GLEW_ARB_instanced_arrays
+      || !GLEW_ARB_draw_instanced)
+    return false;
+  GLuint vs = compileShader(GL_VERTEX_SHADER, VERTEX_SHADER);
+  GLuint fs = compileShader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+  if (vs==0 || fs==0)
+  {
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    return false;
+  }
+  program_ = glCreateProgram();
+  glAttachShader(program_, vs);
+  glAttachShader(program_, fs);
+  glBindAttribLocation(program_, POSITION_ATTRIB, "position");
+  glBindAttribLocation(program_, MATRIX_ATTRIB, "col0");
+  glBindAttribLocation(program_, MATRIX_ATTRIB+1, "col1");
+  glBindAttribLocation(program_, MATRIX_ATTRIB+2, "col2");
+  glBindAttribLocation(program_, MATRIX_ATTRIB+3, "col3");
+  glLinkProgram(program_);
+  glDeleteShader(vs);
+  glDeleteShader(fs);
+  GLint ok;
+  glGetProgramiv(program_, GL_LINK_STATUS, &ok);
+  if (!ok)
+  {
+    cerr << "GlPoseGlyphs: program linking failed" << endl;
+    glDeleteProgram(program_);
+    program_ = 0;
+    return false;
+  }
+  glGenBuffers(1, &glyph_vbo_);
+  glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo_);
+  glBufferData(GL_ARRAY_BUFFER, NUM_GLYPH_VERTICES*sizeof(GlPoint3f),
+               &glyph_[0], GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return true;
+}
+
+void GlPoseGlyphs
+::upload()
+{
+  if (instancing_<0)
+  {
+    instancing_ = initInstancing() ? 1 : 0;
+  }
+  if (num_==0)
+    return;
+  if (instancing_==1)
+  {
+    if (instance_vbo_==0)
+      glGenBuffers(1, &instance_vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, matrices_.size()*sizeof(GLfloat),
+                 &matrices_[0], GL_STATIC_DRAW);
+  }
+  else
+  {
+    vector<GlPoint3f> vertices(NUM_GLYPH_VERTICES*num_);
+#pragma omp parallel for
+    for (int i=0; i<num_; ++i)
+    {
+      Map<const Matrix<GLfloat,4,4,ColMajor> > T(&matrices_[16*i]);
+      for (int j=0; j<NUM_GLYPH_VERTICES; ++j)
+      {
+        Vector3f p = T.topLeftCorner<3,3>()
+            *Vector3f(glyph_[j].x, glyph_[j].y, glyph_[j].z)
+            + T.topRightCorner<3,1>();
+        vertices[NUM_GLYPH_VERTICES*i+j] = GlPoint3f(p[0], p[1], p[2]);
+      }
+    }
+    if (glyph_vbo_==0)
+      glGenBuffers(1, &glyph_vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(GlPoint3f),
+                 &vertices[0], GL_STATIC_DRAW);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  assert(Draw3d::checkForGlError());
+}
+
+void GlPoseGlyphs
+::draw() const
+{
+  if (num_==0)
+    return;
+  if (instancing_==1)
+  {
+    glUseProgram(program_);
+    glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo_);
+    glEnableVertexAttribArray(POSITION_ATTRIB);
+    glVertexAttribPointer(POSITION_ATTRIB, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+    for (GLuint c=0; c<4; ++c)
+    {
+      GLuint attrib = MATRIX_ATTRIB+c;
+      glEnableVertexAttribArray(attrib);
+      glVertexAttribPointer(attrib, 4, GL_FLOAT, GL_FALSE,
+                            16*sizeof(GLfloat),
+                            reinterpret_cast<const GLvoid *>(
+                              4*c*sizeof(GLfloat)));
+      glVertexAttribDivisorARB(attrib, 1);
+    }
+    glDrawArraysInstancedARB(GL_LINES, 0, NUM_GLYPH_VERTICES, num_);
+    for (GLuint c=0; c<4; ++c)
+    {
+      glVertexAttribDivisorARB(MATRIX_ATTRIB+c, 0);
+      glDisableVertexAttribArray(MATRIX_ATTRIB+c);
+    }
+    glDisableVertexAttribArray(POSITION_ATTRIB);
+    glUseProgram(0);
+  }
+  else
+  {
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo_);
+    glVertexPointer(3, GL_FLOAT, 0, 0);
+    glDrawArrays(GL_LINES, 0, NUM_GLYPH_VERTICES*num_);
+    glDisableClientState(GL_VERTEX_ARRAY);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  assert(Draw3d::checkForGlError());
+}
+
+void GlPoseGlyphs
+::release()
+{
+  if (glyph_vbo_!=0)
+    glDeleteBuffers(1, &glyph_vbo_);
+  if (instance_vbo_!=0)
+    glDeleteBuffers(1, &instance_vbo_);
+  if (program_!=0)
+    glDeleteProgram(program_);
+  glyph_vbo_ = 0;
+  instance_vbo_ = 0;
+  program_ = 0;
+  instancing_ = -1;
+  num_ = 0;
+}
+
+}
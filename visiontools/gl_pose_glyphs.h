@@ -0,0 +1,94 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_GL_POSE_GLYPHS_H
+#define VISIONTOOLS_GL_POSE_GLYPHS_H
+
+#include <vector>
+
+#include "gl_data.h"
+
+namespace Sophus
+{
+class SE3;
+class Sim3;
+}
+
+namespace VisionTools
+{
+using namespace Sophus;
+
+//Pose glyphs (as Draw3d::pose) for whole trajectories, drawn with a single
+//call in the current GL color. With ARB_instanced_arrays the glyph is
+//stored once and instanced with one 4x4 matrix per pose; otherwise all
+//glyph vertices are transformed on the CPU into one vertex buffer.
+//Sim3 glyphs are scaled by the similarity as a whole.
+class GlPoseGlyphs
+{
+public:
+  explicit
+  GlPoseGlyphs               (double size = 0.1);
+  ~GlPoseGlyphs              ();
+
+  void
+  set                        (const SE3 * T_world_from_cam, int num);
+  void
+  set                        (const Sim3 * T_world_from_cam, int num);
+  void
+  draw                       () const;
+  void
+  release                    ();
+
+  int size() const
+  {
+    return num_;
+  }
+
+  bool instanced() const
+  {
+    return instancing_==1;
+  }
+
+  static const int NUM_GLYPH_VERTICES = 14;
+
+private:
+  GlPoseGlyphs(const GlPoseGlyphs &);
+  GlPoseGlyphs & operator=(const GlPoseGlyphs &);
+
+  void
+  upload                     ();
+  bool
+  initInstancing             ();
+
+  double size_;
+  int num_;
+  int instancing_;  //-1: not decided yet
+  vector<GLfloat> matrices_;
+  vector<GlPoint3f> glyph_;
+  GLuint glyph_vbo_;
+  GLuint instance_vbo_;
+  GLuint program_;
+};
+
+}
+
+#endif
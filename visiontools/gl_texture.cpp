@@ -0,0 +1,232 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "gl_texture.h"
+#include "draw2d.h"
+
+namespace VisionTools
+{
+GlTexture
+::GlTexture()
+  : texture_(0),
+    next_pbo_(0),
+    width_(0),
+    height_(0),
+    type_(-1),
+    format_(0),
+    gl_type_(0)
+{
+  pbo_[0] = 0;
+  pbo_[1] = 0;
+}
+
+GlTexture
+::~GlTexture()
+{
+  release();
+}
+
+bool GlTexture
+::glFormat(int type, GLint * internal_format, GLenum * format,
+           GLenum * gl_type)
+{
+  switch (type)
+  {
+  case CV_8UC1:
+    *internal_format = GL_LUMINANCE;
+    *format = GL_LUMINANCE;
+    *gl_type = GL_UNSIGNED_BYTE;
+    return true;
+  case CV_16SC1:
+  case CV_16UC1:
+  case CV_8UC2:
+    *internal_format = GL_LUMINANCE;
+    *format = GL_LUMINANCE;
+    *gl_type = GL_UNSIGNED_SHORT;
+    return true;
+  case CV_8UC3:
+    *internal_format = GL_RGB8;
+    *format = GL_BGR;
+    *gl_type = GL_UNSIGNED_BYTE;
+    return true;
+  case CV_8UC4:
+    *internal_format = GL_RGB8;
+    *format = GL_BGRA;
+    *gl_type = GL_UNSIGNED_BYTE;
+    return true;
+  case CV_32FC1:
+    *internal_format = GL_LUMINANCE;
+    *format = GL_LUMINANCE;
+    *gl_type = GL_FLOAT;
+    return true;
+  case CV_32FC3:
+    *internal_format = GL_RGB8;
+    *format = GL_BGR;
+    *gl_type = GL_FLOAT;
+    return true;
+  case CV_32FC4:
+    *internal_format = GL_RGBA8;
+    *format = GL_RGBA;
+    *gl_type = GL_FLOAT;
+    return true;
+  }
+  return false;
+}
+
+bool GlTexture
+::allocate(const cv::Mat & img)
+{
+  if (texture_!=0 && img.cols==width_ && img.rows==height_
+      && img.type()==type_)
+    return true;
+  GLint internal_format;
+  if (!glFormat(img.type(), &internal_format, &format_, &gl_type_))
+  {
+    cerr << "Unknown texture type" << img.type() << endl;
+    return false;
+  }
+  if (texture_==0)
+    glGenTextures(1, &texture_);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glTexImage2D(GL_TEXTURE_2D, 0, internal_format, img.cols, img.rows, 0,
+               format_, gl_type_, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  width_ = img.cols;
+  height_ = img.rows;
+  type_ = img.type();
+  return true;
+}
+
+bool GlTexture
+::upload(const cv::Mat & img)
+{
+  if (!allocate(img))
+    return false;
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, img.step[0]/img.elemSize());
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_,
+                  format_, gl_type_, img.data);
+  glPopClientAttrib();
+  glBindTexture(GL_TEXTURE_2D, 0);
+  assert(Draw2d::checkForGlError());
+  return true;
+}
+
+bool GlTexture
+::stream(const cv::Mat & img)
+{
+  if (!GLEW_ARB_pixel_buffer_object)
+    return upload(img);
+  if (!allocate(img))
+    return false;
+  if (pbo_[0]==0)
+    glGenBuffers(2, pbo_);
+
+  size_t row_bytes = img.cols*img.elemSize();
+  size_t num_bytes = row_bytes*img.rows;
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[next_pbo_]);
+  //orphaning: the driver hands out fresh memory instead of waiting for a
+  //pending transfer out of the old storage
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, num_bytes, NULL, GL_STREAM_DRAW);
+  char * dst = static_cast<char *>(glMapBuffer(GL_PIXEL_UNPACK_BUFFER,
+                                               GL_WRITE_ONLY));
+  if (dst==NULL)
+  {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return upload(img);
+  }
+  if (img.isContinuous())
+  {
+    memcpy(dst, img.data, num_bytes);
+  }
+  else
+  {
+    for (int r=0; r<img.rows; ++r)
+    {
+      memcpy(dst+r*row_bytes, img.ptr(r), row_bytes);
+    }
+  }
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_,
+                  format_, gl_type_, 0);
+  glPopClientAttrib();
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  next_pbo_ = 1-next_pbo_;
+  assert(Draw2d::checkForGlError());
+  return true;
+}
+
+void GlTexture
+::draw(const Vector2i & top_left) const
+{
+  if (texture_==0)
+    return;
+  glEnable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+
+  int x = top_left[0];
+  int y = top_left[1];
+  int w = width_;
+  int h = height_;
+
+  glBegin(GL_QUADS);
+  glTexCoord2f(0.0f, 0.0f); glVertex2i(x, y);
+  glTexCoord2f(0.0f, 1.0f); glVertex2i(x, y+h);
+  glTexCoord2f(1.0f, 1.0f); glVertex2i(x+w, y+h);
+  glTexCoord2f(1.0f, 0.0f); glVertex2i(x+w, y);
+  glEnd();
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glDisable(GL_TEXTURE_2D);
+  assert(Draw2d::checkForGlError());
+}
+
+void GlTexture
+::release()
+{
+  if (texture_!=0)
+    glDeleteTextures(1, &texture_);
+  if (pbo_[0]!=0)
+    glDeleteBuffers(2, pbo_);
+  texture_ = 0;
+  pbo_[0] = 0;
+  pbo_[1] = 0;
+  next_pbo_ = 0;
+  width_ = 0;
+  height_ = 0;
+  type_ = -1;
+}
+
+}
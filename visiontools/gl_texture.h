@@ -0,0 +1,101 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_GL_TEXTURE_H
+#define VISIONTOOLS_GL_TEXTURE_H
+
+#include <opencv2/core/core.hpp>
+
+#include "gl_data.h"
+
+namespace VisionTools
+{
+
+//Texture which keeps its storage as long as image size and type do not
+//change, so re-uploads are plain glTexSubImage2D calls. Non-contiguous
+//images (ROIs) are read in place using GL_UNPACK_ROW_LENGTH.
+//The caller's pixel-store state is saved and restored around uploads.
+class GlTexture
+{
+public:
+  GlTexture                  ();
+  ~GlTexture                 ();
+
+  bool                       //false if the image type is not supported
+  upload                     (const cv::Mat & img);
+  //Upload through two alternating pixel buffer objects: the image is
+  //copied into a freshly orphaned buffer and the transfer into the texture
+  //happens asynchronously, while the other buffer may still be in flight.
+  //Falls back to upload() without ARB_pixel_buffer_object.
+  bool
+  stream                     (const cv::Mat & img);
+  void
+  draw                       (const Vector2i & top_left = Vector2i(0,0)) const;
+  void
+  release                    ();
+
+  GLuint id() const
+  {
+    return texture_;
+  }
+
+  int width() const
+  {
+    return width_;
+  }
+
+  int height() const
+  {
+    return height_;
+  }
+
+  int type() const
+  {
+    return type_;
+  }
+
+  static bool
+  glFormat                   (int type,
+                              GLint * internal_format,
+                              GLenum * format,
+                              GLenum * gl_type);
+
+private:
+  GlTexture(const GlTexture &);
+  GlTexture & operator=(const GlTexture &);
+
+  bool
+  allocate                   (const cv::Mat & img);
+
+  GLuint texture_;
+  GLuint pbo_[2];
+  int next_pbo_;
+  int width_;
+  int height_;
+  int type_;
+  GLenum format_;
+  GLenum gl_type_;
+};
+
+}
+
+#endif
@@ -0,0 +1,165 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "image_pyramid.h"
+#include "accessor_macros.h"
+
+namespace VisionTools
+{
+namespace
+{
+void halfSampleRowsByte(const cv::Mat & src, cv::Mat * dst,
+                    int begin, int end)
+{
+  int width = dst->cols;
+  for (int y=begin; y<end; ++y)
+  {
+    const unsigned char * s0 = src.ptr<unsigned char>(2*y);
+    const unsigned char * s1 = src.ptr<unsigned char>(2*y+1);
+    unsigned char * d = dst->ptr<unsigned char>(y);
+    int x = 0;
+#ifdef __SSE2__
+    //16 output pixels per iteration: add even and odd bytes of both rows
+    //as 16 bit integers, round, shift and pack again
+    const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+    const __m128i two = _mm_set1_epi16(2);
+    for (; x+16<=width; x+=16)
+    {
+      __m128i sum[2];
+      for (int i=0; i<2; ++i)
+      {
+        __m128i r0 = _mm_loadu_si128(
+              reinterpret_cast<const __m128i *>(s0+2*x+16*i));
+        __m128i r1 = _mm_loadu_si128(
+              reinterpret_cast<const __m128i *>(s1+2*x+16*i));
+        __m128i s = _mm_add_epi16(
+              _mm_add_epi16(_mm_and_si128(r0, low_bytes),
+                            _mm_srli_epi16(r0, 8)),
+              _mm_add_epi16(_mm_and_si128(r1, low_bytes),
+                            _mm_srli_epi16(r1, 8)));
+        sum[i] = _mm_srli_epi16(_mm_add_epi16(s, two), 2);
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(d+x),
+                       _mm_packus_epi16(sum[0], sum[1]));
+    }
+#endif
+    for (; x<width; ++x)
+    {
+      d[x] = (s0[2*x] + s0[2*x+1] + s1[2*x] + s1[2*x+1] + 2) >> 2;
+    }
+  }
+}
+
+void halfSampleRowsFloat(const cv::Mat & src, cv::Mat * dst,
+                         int begin, int end)
+{
+  int width = dst->cols;
+  for (int y=begin; y<end; ++y)
+  {
+    const float * s0 = src.ptr<float>(2*y);
+    const float * s1 = src.ptr<float>(2*y+1);
+    float * d = dst->ptr<float>(y);
+    for (int x=0; x<width; ++x)
+    {
+      d[x] = 0.25f*(s0[2*x] + s0[2*x+1] + s1[2*x] + s1[2*x+1]);
+    }
+  }
+}
+}
+
+ImagePyramid
+::ImagePyramid(int num_levels, Filter filter)
+  : num_levels_(num_levels),
+    filter_(filter),
+    levels_(num_levels)
+{
+  assert(num_levels>=1);
+}
+
+void ImagePyramid
+::halfSample(const cv::Mat & src, cv::Mat * dst)
+{
+  assert(src.type()==CV_8UC1 || src.type()==CV_32FC1);
+  dst->create(src.rows/2, src.cols/2, src.type());
+
+  int rows = dst->rows;
+  int num_bands = 1;
+#ifdef _OPENMP
+  num_bands = std::max(1, std::min(omp_get_max_threads(), rows/16));
+#endif
+
+#pragma omp parallel for
+  for (int b=0; b<num_bands; ++b)
+  {
+    int begin = rows*b/num_bands;
+    int end = rows*(b+1)/num_bands;
+    if (src.type()==CV_8UC1)
+      halfSampleRowsByte(src, dst, begin, end);
+    else
+      halfSampleRowsFloat(src, dst, begin, end);
+  }
+}
+
+void ImagePyramid
+::build(const cv::Mat & img)
+{
+  levels_[0] = img;
+  for (int l=1; l<num_levels_; ++l)
+  {
+    const cv::Mat & src = levels_[l-1];
+    if (filter_==GAUSSIAN)
+    {
+      cv::pyrDown(src, levels_[l], cv::Size(src.cols/2, src.rows/2));
+    }
+    else
+    {
+      halfSample(src, &levels_[l]);
+    }
+  }
+}
+
+void ImagePyramid
+::build(const cv::Mat & img, const LinearCamera & cam)
+{
+  build(img);
+  cameras_.resize(num_levels_);
+  for (int l=0; l<num_levels_; ++l)
+  {
+    cameras_[l] = LinearCamera(pyrFromZero_d(cam.focal_length(), l),
+                               pyrFromZero_2d(cam.principal_point(), l),
+                               levels_[l].size());
+  }
+}
+
+}
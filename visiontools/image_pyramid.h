@@ -0,0 +1,90 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_IMAGE_PYRAMID_H
+#define VISIONTOOLS_IMAGE_PYRAMID_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <Eigen/StdVector>
+
+#include "linear_camera.h"
+
+namespace VisionTools
+{
+
+//Image pyramid whose level l has size (w>>l, h>>l), so coordinates convert
+//with pyrFromZero_*/zeroFromPyr_* from accessor_macros.h. Level buffers are
+//kept between calls to build(), so a pyramid per camera stream allocates
+//only once. Level 0 shares its data with the input image.
+class ImagePyramid
+{
+public:
+  enum Filter
+  {
+    BOX,      //2x2 mean, vectorised and parallel over row bands
+    GAUSSIAN  //5x5 Gaussian (cv::pyrDown)
+  };
+
+  explicit
+  ImagePyramid               (int num_levels = 4,
+                              Filter filter = BOX);
+
+  void                       //CV_8UC1 or CV_32FC1
+  build                      (const cv::Mat & img);
+  //also derives the camera of every level from cam (of level 0)
+  void
+  build                      (const cv::Mat & img,
+                              const LinearCamera & cam);
+
+  const cv::Mat & level(int l) const
+  {
+    assert(l>=0 && l<num_levels_);
+    return levels_[l];
+  }
+
+  const LinearCamera & camera(int l) const
+  {
+    assert(l>=0 && l<static_cast<int>(cameras_.size()));
+    return cameras_[l];
+  }
+
+  int num_levels() const
+  {
+    return num_levels_;
+  }
+
+  static void                //dst gets size (w/2, h/2)
+  halfSample                 (const cv::Mat & src,
+                              cv::Mat * dst);
+
+private:
+  int num_levels_;
+  Filter filter_;
+  vector<cv::Mat> levels_;
+  vector<LinearCamera, aligned_allocator<LinearCamera> > cameras_;
+};
+
+}
+
+#endif
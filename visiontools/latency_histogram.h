@@ -0,0 +1,164 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#ifndef VISIONTOOLS_LATENCY_HISTOGRAM_H
+#define VISIONTOOLS_LATENCY_HISTOGRAM_H
+
+#include <cassert>
+#include <stdint.h>
+#include <string.h>
+
+namespace VisionTools
+{
+
+//Fixed-size log-linear histogram (HDR histogram style) of non-negative
+//integer values such as nanoseconds. Values below 2^(SUB_BITS+1) are
+//counted exactly; above, each power of two is split into 2^SUB_BITS
+//buckets, i.e. the relative error is below 2^-SUB_BITS (about 3%).
+//Values are clamped to 2^MAX_BITS-1 (about 18 minutes in ns).
+//record is O(1), percentile is O(NUM_BUCKETS).
+class LatencyHistogram
+{
+public:
+  static const int SUB_BITS = 5;
+  static const int MAX_BITS = 40;
+  static const int NUM_BUCKETS = (MAX_BITS-SUB_BITS+1)<<SUB_BITS;
+
+  LatencyHistogram()
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    memset(counts_, 0, sizeof(counts_));
+    count_ = 0;
+    sum_ = 0;
+    min_ = 0;
+    max_ = 0;
+  }
+
+  void record(int64_t value)
+  {
+    if (value<0)
+      value = 0;
+    if (value>=(static_cast<int64_t>(1)<<MAX_BITS))
+      value = (static_cast<int64_t>(1)<<MAX_BITS)-1;
+    ++counts_[bucket(value)];
+    if (count_==0 || value<min_)
+      min_ = value;
+    if (value>max_)
+      max_ = value;
+    ++count_;
+    sum_ += value;
+  }
+
+  void add(const LatencyHistogram & other)
+  {
+    if (other.count_==0)
+      return;
+    for (int i=0; i<NUM_BUCKETS; ++i)
+    {
+      counts_[i] += other.counts_[i];
+    }
+    if (count_==0 || other.min_<min_)
+      min_ = other.min_;
+    if (other.max_>max_)
+      max_ = other.max_;
+    count_ += other.count_;
+    sum_ += other.sum_;
+  }
+
+  //p in [0,100]; returns the midpoint of the bucket holding the
+  //p-th percentile, clamped to [min,max]
+  int64_t percentile(double p) const
+  {
+    if (count_==0)
+      return 0;
+    int64_t rank = static_cast<int64_t>(p*0.01*count_ + 0.5);
+    if (rank<1)
+      rank = 1;
+    if (rank>count_)
+      rank = count_;
+    int64_t seen = 0;
+    for (int i=0; i<NUM_BUCKETS; ++i)
+    {
+      seen += counts_[i];
+      if (seen>=rank)
+      {
+        int64_t value = midpoint(i);
+        return value<min_ ? min_ : (value>max_ ? max_ : value);
+      }
+    }
+    return max_;
+  }
+
+  int64_t count() const
+  {
+    return count_;
+  }
+
+  int64_t min() const
+  {
+    return min_;
+  }
+
+  int64_t max() const
+  {
+    return max_;
+  }
+
+  double mean() const
+  {
+    return count_==0 ? 0. : static_cast<double>(sum_)/count_;
+  }
+
+private:
+  static int bucket(int64_t value)
+  {
+    if (value<(static_cast<int64_t>(2)<<SUB_BITS))
+      return value;
+    int msb = 63-__builtin_clzll(value);
+    int shift = msb-SUB_BITS;
+    return ((shift+1)<<SUB_BITS) + ((value>>shift) - (1<<SUB_BITS));
+  }
+
+  static int64_t midpoint(int idx)
+  {
+    if (idx<(2<<SUB_BITS))
+      return idx;
+    int shift = (idx>>SUB_BITS)-1;
+    int64_t sub = (idx&((1<<SUB_BITS)-1)) + (1<<SUB_BITS);
+    return (sub<<shift) + ((static_cast<int64_t>(1)<<shift)>>1);
+  }
+
+  uint32_t counts_[NUM_BUCKETS];
+  int64_t count_;
+  int64_t sum_;
+  int64_t min_;
+  int64_t max_;
+};
+
+}
+
+#endif
@@ -20,6 +20,16 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <stdint.h>
+
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <sophus/se3.h>
+
 #include "linear_camera.h"
 
 
@@ -33,6 +43,7 @@ LinearCamera
     intrinsics_(Matrix3d::Identity()),
     intrinsics_inv_(Matrix3d::Identity())
 {
+  initialise();
 }
 
 LinearCamera
@@ -83,18 +94,131 @@ void LinearCamera
   intrinsics_inv_(1,1) = inv_focal_length_;
   intrinsics_inv_(0,2) = -principle_point_[0]*inv_focal_length_;
   intrinsics_inv_(1,2) = -principle_point_[1]*inv_focal_length_;
+  jacobian_ = intrinsics_.block(0,0,2,2);
+  inv_jacobian_ = intrinsics_inv_.block(0,0,2,2);
 }
 
-Vector2d LinearCamera
-::map(const Vector2d& point) const
+//Whole batch as one Eigen expression: each column is a single packet,
+//so this compiles to one multiply-add per point without temporaries.
+void LinearCamera
+::map_batch(const double * camframes, int num, double * imframes) const
 {
-  return focal_length_*point + principle_point_;
+  Map<const Matrix2Xd> in(camframes, 2, num);
+  Map<Matrix2Xd> out(imframes, 2, num);
+  out = (focal_length_*in).colwise() + principle_point_;
 }
 
-Vector2d LinearCamera
-::unmap(const Vector2d& dist_point) const
+void LinearCamera
+::unmap_batch(const double * imframes, int num, double * camframes) const
 {
-  return inv_focal_length_*(dist_point-principle_point_);
+  Map<const Matrix2Xd> in(imframes, 2, num);
+  Map<Matrix2Xd> out(camframes, 2, num);
+  out = inv_focal_length_*(in.colwise() - principle_point_);
+}
+
+//uv and depth are filled for all points. visible_ids lists, in ascending
+//order, the points with positive depth for which isInFrame(uv_i.cast<int>(),
+//boundry) holds. Returns the number of visible points.
+//
+//The points are split into one contiguous band per thread. Each band is
+//processed in blocks: a branch-free loop projects the block and computes
+//its visibility flags, then the visible ids are appended without branches
+//into the band's own part of visible_ids. Finally the bands are moved
+//together. visible_ids serves as its own scratch space, so a vector which
+//is reused across calls causes no allocation.
+int LinearCamera
+::projectInFrame(const Matrix3Xd & xyz_world,
+                 const SE3 & T_cw,
+                 int boundry,
+                 Matrix2Xd * uv,
+                 VectorXd * depth,
+                 vector<int> * visible_ids) const
+{
+  static const int BLOCK_SIZE = 256;
+  static const int MAX_BANDS = 64;
+
+  int num = xyz_world.cols();
+  uv->resize(2, num);
+  depth->resize(num);
+  visible_ids->resize(num);
+  if (num==0)
+    return 0;
+
+  const Matrix3d R_cw = T_cw.rotation_matrix();
+  const Vector3d t_cw = T_cw.translation();
+  const int min_u = boundry;
+  const int min_v = boundry;
+  const int max_u = image_size_.width-boundry;
+  const int max_v = image_size_.height-boundry;
+  //int(u)>=min_u implies u>min_u-1 and int(u)<max_u implies u<max_u (int
+  //truncates toward zero), so these double bounds only reject points
+  //which fail anyway, and make the int casts below safe
+  const double lower_u = min_u-1.;
+  const double lower_v = min_v-1.;
+  const double upper_u = max_u;
+  const double upper_v = max_v;
+
+  const double * xyz = xyz_world.data();
+  double * uv_data = uv->data();
+  double * depth_data = depth->data();
+  int * ids = &(*visible_ids)[0];
+
+  int num_bands = 1;
+#ifdef _OPENMP
+  if (num>10000)
+    num_bands = std::min(omp_get_max_threads(), MAX_BANDS);
+#endif
+  int band_counts[MAX_BANDS];
+
+#pragma omp parallel for
+  for (int b=0; b<num_bands; ++b)
+  {
+    int begin = static_cast<int64_t>(num)*b/num_bands;
+    int end = static_cast<int64_t>(num)*(b+1)/num_bands;
+    int count = 0;
+    unsigned char in_frame[BLOCK_SIZE];
+    for (int block=begin; block<end; block+=BLOCK_SIZE)
+    {
+      int block_end = std::min(block+BLOCK_SIZE, end);
+#pragma omp simd
+      for (int i=block; i<block_end; ++i)
+      {
+        const double * p = xyz+3*i;
+        double x = R_cw(0,0)*p[0] + R_cw(0,1)*p[1] + R_cw(0,2)*p[2] + t_cw[0];
+        double y = R_cw(1,0)*p[0] + R_cw(1,1)*p[1] + R_cw(1,2)*p[2] + t_cw[1];
+        double z = R_cw(2,0)*p[0] + R_cw(2,1)*p[1] + R_cw(2,2)*p[2] + t_cw[2];
+        double inv_z = 1./z;
+        double u = focal_length_*x*inv_z + principle_point_[0];
+        double v = focal_length_*y*inv_z + principle_point_[1];
+        depth_data[i] = z;
+        uv_data[2*i] = u;
+        uv_data[2*i+1] = v;
+        bool in_range = z>0 && u>lower_u && u<upper_u
+            && v>lower_v && v<upper_v;
+        //out of range values are replaced before the cast
+        int iu = static_cast<int>(in_range ? u : min_u);
+        int iv = static_cast<int>(in_range ? v : min_v);
+        in_frame[i-block] = in_range && iu>=min_u && iu<max_u
+            && iv>=min_v && iv<max_v;
+      }
+      for (int i=block; i<block_end; ++i)
+      {
+        ids[begin+count] = i;
+        count += in_frame[i-block];
+      }
+    }
+    band_counts[b] = count;
+  }
+
+  int num_visible = band_counts[0];
+  for (int b=1; b<num_bands; ++b)
+  {
+    int begin = static_cast<int64_t>(num)*b/num_bands;
+    std::copy(ids+begin, ids+begin+band_counts[b], ids+num_visible);
+    num_visible += band_counts[b];
+  }
+  visible_ids->resize(num_visible);
+  return num_visible;
 }
 
 pangolin::OpenGlMatrixSpec LinearCamera
@@ -27,13 +27,18 @@
 #include <GL/freeglut.h>
 #include <pangolin/display.h>
 
-#include "abstract_camera.h"
+#include "camera_model.h"
 
+namespace Sophus
+{
+class SE3;
+}
 
 namespace VisionTools
 {
+using namespace Sophus;
 
-class LinearCamera : public AbstractCamera
+class LinearCamera : public CameraModel<LinearCamera>
 {
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -45,10 +50,24 @@ public:
   LinearCamera             (const double & focal_length,
                             const Vector2d & principle_point,
                             const cv::Size & image_size);
-  Vector2d
-  map                      (const Vector2d& camframe) const;
-  Vector2d
-  unmap                    (const Vector2d& imframe) const;
+  void
+  map_batch                (const double * camframes,
+                            int num,
+                            double * imframes) const;
+  void
+  unmap_batch              (const double * imframes,
+                            int num,
+                            double * camframes) const;
+  using AbstractCamera::map_batch;
+  using AbstractCamera::unmap_batch;
+  int                      //transforms, projects and culls in one pass;
+                           //reuse visible_ids to avoid allocations
+  projectInFrame           (const Matrix3Xd & xyz_world,
+                            const SE3 & T_cw,
+                            int boundry,
+                            Matrix2Xd * uv,
+                            VectorXd * depth,
+                            vector<int> * visible_ids) const;
   pangolin::OpenGlMatrixSpec
   getOpenGlMatrixSpec      () const;
 
@@ -80,30 +99,48 @@ public:
   Matrix2d
   jacobian(const Vector2d& camframe) const
   {
-    return jacobian();
+    return jacobian_;
   }
 
-  Matrix2d
+  const Matrix2d &
   inv_jacobian(const Vector2d& imframe) const
   {
-    return inv_jacobian();
+    return inv_jacobian_;
   }
 
-  Matrix2d
+  const Matrix2d &
   jacobian() const
   {
-    return intrinsics_.block(0,0,2,2);
+    return jacobian_;
   }
 
-  Matrix2d
+  const Matrix2d &
   inv_jacobian() const
   {
-    return intrinsics_inv_.block(0,0,2,2);
+    return inv_jacobian_;
   }
 
   static const int obs_dim = 2;
   static const int NUM_PARAMS = 4;
 
+private:
+  friend class CameraModel<LinearCamera>;
+
+  Vector2d projectImpl(const Vector2d& camframe) const
+  {
+    return focal_length_*camframe + principle_point_;
+  }
+
+  Vector2d unprojectImpl(const Vector2d& imframe) const
+  {
+    return inv_focal_length_*(imframe-principle_point_);
+  }
+
+  const Matrix2d & projectJacobianImpl(const Vector2d& camframe) const
+  {
+    return jacobian_;
+  }
+
 protected:
   void initialise();
 
@@ -114,6 +151,8 @@ protected:
   Matrix3d intrinsics_;
   Matrix3d intrinsics_inv_;
   double inv_focal_length_;
+  Matrix2d jacobian_;
+  Matrix2d inv_jacobian_;
 };
 }
 #endif
@@ -0,0 +1,164 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_MAP_ACCUMULATOR_H
+#define VISIONTOOLS_MAP_ACCUMULATOR_H
+
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "accessor_macros.h"
+
+namespace VisionTools
+{
+
+//ADD_TO_MAP_ELEM from inside OpenMP parallel loops: every thread adds to
+//its own shard map, and reduce() merges the shards pairwise in parallel
+//(log2(#threads) rounds) before adding them to the result. MAP can be any
+//map type ADD_TO_MAP_ELEM supports whose mapped type defines +=.
+//Shards are indexed by omp_get_thread_num(), so use it from a single,
+//non-nested parallel region at a time.
+template <class MAP>
+class MapAccumulator
+{
+public:
+  typedef typename MAP::key_type key_type;
+  typedef typename MAP::mapped_type mapped_type;
+
+  explicit
+  MapAccumulator             (int num_shards = maxThreads())
+    : shards_(num_shards)
+  {
+  }
+
+  MAP & local()
+  {
+#ifdef _OPENMP
+    int i = omp_get_thread_num();
+#else
+    int i = 0;
+#endif
+    assert(i<static_cast<int>(shards_.size()));
+    return shards_[i].map;
+  }
+
+  void add(const key_type & key, const mapped_type & val)
+  {
+    ADD_TO_MAP_ELEM(key, val, &local());
+  }
+
+  //adds all accumulated values to *result and clears the shards
+  void
+  reduce                     (MAP * result);
+  void
+  clear                      ();
+
+  int num_shards() const
+  {
+    return shards_.size();
+  }
+
+  static int maxThreads()
+  {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+  }
+
+private:
+  //padded, so that threads updating neighbouring shards do not share the
+  //cache line holding the map's bookkeeping
+  struct Shard
+  {
+    MAP map;
+    char padding[64];
+  };
+
+  static void
+  mergeInto                  (MAP * src,
+                              MAP * dst);
+
+  vector<Shard> shards_;
+};
+
+template <class MAP>
+void MapAccumulator<MAP>
+::mergeInto(MAP * src, MAP * dst)
+{
+  using std::swap;
+  if (dst->empty())
+  {
+    swap(*src, *dst);
+    return;
+  }
+  if (src->size()>dst->size())
+    swap(*src, *dst);
+  for (typename MAP::const_iterator it=src->begin(); it!=src->end(); ++it)
+  {
+    ADD_TO_MAP_ELEM(it->first, it->second, dst);
+  }
+  src->clear();
+}
+
+template <class MAP>
+void MapAccumulator<MAP>
+::reduce(MAP * result)
+{
+  int n = shards_.size();
+  for (int stride=1; stride<n; stride*=2)
+  {
+#pragma omp parallel for schedule(dynamic)
+    for (int i=0; i<n-stride; i+=2*stride)
+    {
+      mergeInto(&shards_[i+stride].map, &shards_[i].map);
+    }
+  }
+  if (n>0)
+    mergeInto(&shards_[0].map, result);
+}
+
+template <class MAP>
+void MapAccumulator<MAP>
+::clear()
+{
+  for (size_t i=0; i<shards_.size(); ++i)
+  {
+    shards_[i].map.clear();
+  }
+}
+
+template <class MAP>
+void ADD_TO_MAP_ELEM(const typename MAP::key_type & key,
+                     const typename MAP::mapped_type & val,
+                     MapAccumulator<MAP> * m)
+{
+  m->add(key, val);
+}
+
+}
+
+#endif
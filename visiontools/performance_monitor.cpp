@@ -20,116 +20,498 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+
+#include <stdexcept>
+
 #include "performance_monitor.h"
 
 namespace VisionTools
 {
 using namespace std;
 
+//Per-thread call tree. Node 0 is the root. The owning thread appends nodes
+//and updates the counters; new_frame reads them with atomic loads. Nodes
+//are immutable except for the counters once num_nodes has been published.
+//When the thread exits, the key destructor sets retired; new_frame then
+//merges the log one last time and frees it.
+struct PerformanceMonitor::ThreadLog
+{
+  static const int MAX_NODES = 256;
+  static const int MAX_DEPTH = 64;
+
+  struct Node
+  {
+    int timer;
+    int parent;
+    int first_child;
+    int next_sibling;
+    int64_t total_ns;
+    int64_t count;
+  };
+
+  ThreadLog() : num_nodes(1), depth(0), retired(0)
+  {
+    nodes[0].timer = -1;
+    nodes[0].parent = -1;
+    nodes[0].first_child = -1;
+    nodes[0].next_sibling = -1;
+    nodes[0].total_ns = 0;
+    nodes[0].count = 0;
+    stack[0] = 0;
+    for (int i=0; i<MAX_NODES; ++i)
+    {
+      merged_ns[i] = 0;
+      merged_count[i] = 0;
+      tree_id[i] = -1;
+    }
+  }
+
+  //returns -1 if the tree is full
+  int child(int parent, int timer)
+  {
+    if (parent<0)
+      return -1;
+    for (int c=nodes[parent].first_child; c>=0; c=nodes[c].next_sibling)
+    {
+      if (nodes[c].timer==timer)
+        return c;
+    }
+    int id = num_nodes;
+    if (id>=MAX_NODES)
+      return -1;
+    Node & n = nodes[id];
+    n.timer = timer;
+    n.parent = parent;
+    n.first_child = -1;
+    n.next_sibling = nodes[parent].first_child;
+    n.total_ns = 0;
+    n.count = 0;
+    nodes[parent].first_child = id;
+    __atomic_store_n(&num_nodes, id+1, __ATOMIC_RELEASE);
+    return id;
+  }
+
+  //pthread key destructor, runs on the owning thread when it exits
+  static void retire(void * log)
+  {
+    __atomic_store_n(&static_cast<ThreadLog *>(log)->retired, 1,
+                     __ATOMIC_RELEASE);
+  }
+
+  //written by the owning thread
+  Node nodes[MAX_NODES];
+  int num_nodes;
+  int stack[MAX_DEPTH];
+  int64_t start_ns[MAX_DEPTH];
+  int depth;
+  int retired;
+
+  //used by new_frame only
+  int64_t merged_ns[MAX_NODES];
+  int64_t merged_count[MAX_NODES];
+  int tree_id[MAX_NODES];
+};
+
+PerformanceMonitor
+::PerformanceMonitor()
+  : fps_(0),
+    frames_per_slice_(100),
+    num_slices_(10),
+    cur_slice_(0),
+    frames_in_slice_(0),
+    frame_durations_(20),
+    num_frames_(0),
+    frame_start_ns_(0),
+    trace_writer_(NULL),
+    trace_start_ns_(0)
+{
+  pthread_key_create(&log_key_, &ThreadLog::retire);
+  pthread_mutex_init(&logs_mutex_, NULL);
+  //the first frame starts now, so that new_frame() and start_trace() also
+  //work without setup()
+  frame_timer_.start();
+  frame_start_ns_ = StopWatch::monotonic_ns();
+}
+
 PerformanceMonitor
-::PerformanceMonitor()/*:
-  ringbuffer_(30)*/
+::~PerformanceMonitor()
 {
+  stop_trace();
+  for (size_t i=0; i<logs_.size(); ++i)
+  {
+    delete logs_[i];
+  }
+  pthread_key_delete(log_key_);
+  pthread_mutex_destroy(&logs_mutex_);
 }
 
 void PerformanceMonitor
-::setup(pangolin::DataLog * log)
+::setup()
 {
   fps_ = 0;
-  timers_.size();
+  frame_timer_.stop();
+  frame_timer_.reset();
   frame_timer_.start();
-  for (std::list<pair<string, StopWatch> >::iterator iter = timers_.begin();
-       iter!=timers_.end(); ++iter)
+  frame_start_ns_ = StopWatch::monotonic_ns();
+}
+
+void PerformanceMonitor
+::setup(pangolin::DataLog * log)
+{
+  setup();
+  log->SetLabels(names_);
+}
+
+int PerformanceMonitor
+::add(const string & str)
+{
+  map<string,int>::const_iterator it = handles_.find(str);
+  if (it!=handles_.end())
   {
-    names_.push_back(iter->first);
+    return it->second;
   }
-  log->SetLabels(names_);
+  int id = names_.size();
+  names_.push_back(str);
+  handles_.insert(make_pair(str, id));
+  frame_times_.push_back(0);
+  frame_counts_.push_back(0);
+  total_hists_.push_back(LatencyHistogram());
+  slice_hists_.push_back(vector<LatencyHistogram>(num_slices_));
+  return id;
+}
+
+int PerformanceMonitor
+::handle(const string & str) const
+{
+  map<string,int>::const_iterator it = handles_.find(str);
+  if (it==handles_.end())
+  {
+    throw std::runtime_error("PerMon: Unknown type!");
+  }
+  return it->second;
+}
+
+PerformanceMonitor::ThreadLog * PerformanceMonitor
+::thread_log()
+{
+  ThreadLog * log = static_cast<ThreadLog *>(pthread_getspecific(log_key_));
+  if (log==NULL)
+  {
+    log = new ThreadLog;
+    pthread_mutex_lock(&logs_mutex_);
+    logs_.push_back(log);
+    pthread_mutex_unlock(&logs_mutex_);
+    pthread_setspecific(log_key_, log);
+  }
+  return log;
 }
 
 void PerformanceMonitor
-::add(const string & str)
+::start(int handle)
 {
-  timers_.push_back(make_pair(str, StopWatch()));
+  assert(handle>=0 && handle<static_cast<int>(names_.size()));
+  ThreadLog * log = thread_log();
+  assert(log->depth+1<ThreadLog::MAX_DEPTH);
+  int node = log->child(log->stack[log->depth], handle);
+  ++log->depth;
+  log->stack[log->depth] = node;
+  log->start_ns[log->depth] = StopWatch::monotonic_ns();
 }
 
 void PerformanceMonitor
-::new_frame()
+::stop(int handle)
 {
-  static int count_frames = 0;
-  ++count_frames;
-  for (list<pair<string, StopWatch> >::iterator iter = timers_.begin();
-       iter!=timers_.end(); ++iter)
+  int64_t end_ns = StopWatch::monotonic_ns();
+  ThreadLog * log = thread_log();
+  assert(log->depth>0);
+  int node = log->stack[log->depth];
+  int64_t duration = end_ns-log->start_ns[log->depth];
+  --log->depth;
+  if (node>=0)
   {
-    iter->second.reset();
+    ThreadLog::Node & n = log->nodes[node];
+    assert(n.timer==handle);
+    __atomic_store_n(&n.total_ns, n.total_ns+duration, __ATOMIC_RELAXED);
+    __atomic_store_n(&n.count, n.count+1, __ATOMIC_RELAXED);
   }
-  if(count_frames>=1)
+}
+
+void PerformanceMonitor
+::start(const std::string & str)
+{
+  start(handle(str));
+}
+
+void PerformanceMonitor
+::stop(const std::string & str)
+{
+  stop(handle(str));
+}
+
+int PerformanceMonitor
+::call_node(int parent, int timer)
+{
+  pair<int,int> key(parent, timer);
+  map<pair<int,int>,int>::const_iterator it = call_tree_index_.find(key);
+  if (it!=call_tree_index_.end())
   {
-    frame_timer_.stop();
-    static RingBuffer<double> ring_buf(20);
-    ring_buf.push_back(frame_timer_.get_stopped_time());
-    int size = ring_buf.size();
-    double sum = 0;
-    for (int i=0;i<size; ++i)
+    return it->second;
+  }
+  CallNode n;
+  n.timer = timer;
+  n.parent = parent;
+  n.frame_time = 0;
+  n.total_time = 0;
+  n.frame_count = 0;
+  n.total_count = 0;
+  int id = call_tree_.size();
+  call_tree_.push_back(n);
+  call_tree_index_.insert(make_pair(key, id));
+  return id;
+}
+
+void PerformanceMonitor
+::merge(ThreadLog * log)
+{
+  int num_nodes = __atomic_load_n(&log->num_nodes, __ATOMIC_ACQUIRE);
+  //parents are always created before their children
+  for (int i=1; i<num_nodes; ++i)
+  {
+    const ThreadLog::Node & n = log->nodes[i];
+    if (log->tree_id[i]<0)
     {
-      sum += ring_buf.get(i);
+      int parent = n.parent==0 ? -1 : log->tree_id[n.parent];
+      log->tree_id[i] = call_node(parent, n.timer);
     }
-    fps_ = size/sum;
-    frame_timer_.start();
+    int64_t total_ns = __atomic_load_n(&n.total_ns, __ATOMIC_RELAXED);
+    int64_t count = __atomic_load_n(&n.count, __ATOMIC_RELAXED);
+    double time = (total_ns-log->merged_ns[i])*1e-9;
+    long num = count-log->merged_count[i];
+    log->merged_ns[i] = total_ns;
+    log->merged_count[i] = count;
+
+    CallNode & node = call_tree_[log->tree_id[i]];
+    node.frame_time += time;
+    node.total_time += time;
+    node.frame_count += num;
+    node.total_count += num;
+    frame_times_[n.timer] += time;
+    frame_counts_[n.timer] += num;
   }
 }
 
-list<pair<string, StopWatch> >::iterator PerformanceMonitor
-::find_timer(const string & str)
+void PerformanceMonitor
+::new_frame()
 {
-  for (list<pair<string, StopWatch> >::iterator it=timers_.begin();
-       it!=timers_.end(); ++it)
+  for (size_t i=0; i<frame_times_.size(); ++i)
   {
-    if (it->first == str){
-      return it;
+    frame_times_[i] = 0;
+    frame_counts_[i] = 0;
+  }
+  for (size_t i=0; i<call_tree_.size(); ++i)
+  {
+    call_tree_[i].frame_time = 0;
+    call_tree_[i].frame_count = 0;
+  }
+  pthread_mutex_lock(&logs_mutex_);
+  size_t num_live = 0;
+  for (size_t i=0; i<logs_.size(); ++i)
+  {
+    ThreadLog * log = logs_[i];
+    //load before merging, so that a retired log is merged completely
+    bool retired = __atomic_load_n(&log->retired, __ATOMIC_ACQUIRE);
+    merge(log);
+    if (retired)
+    {
+      delete log;
+    }
+    else
+    {
+      logs_[num_live] = log;
+      ++num_live;
     }
   }
-  return timers_.end();
+  logs_.resize(num_live);
+  pthread_mutex_unlock(&logs_mutex_);
+  record_stats();
+
+  int64_t frame_end_ns = StopWatch::monotonic_ns();
+  if (trace_writer_!=NULL)
+  {
+    write_trace(frame_end_ns);
+  }
+  ++num_frames_;
+  frame_start_ns_ = frame_end_ns;
+
+  frame_timer_.stop();
+  frame_durations_.push_back(frame_timer_.get_last_time());
+  fps_ = 1./frame_durations_.mean();
+  frame_timer_.start();
 }
 
 void PerformanceMonitor
-::start(const std::string & str)
+::set_stats_window(int frames_per_slice, int num_slices)
+{
+  assert(frames_per_slice>0 && num_slices>0);
+  frames_per_slice_ = frames_per_slice;
+  num_slices_ = num_slices;
+  cur_slice_ = 0;
+  frames_in_slice_ = 0;
+  for (size_t i=0; i<slice_hists_.size(); ++i)
+  {
+    slice_hists_[i].assign(num_slices_, LatencyHistogram());
+  }
+}
+
+//Sliding window as a ring of slices: the oldest slice is cleared and
+//reused once the current one holds frames_per_slice_ frames.
+void PerformanceMonitor
+::record_stats()
 {
-  list<pair<string, StopWatch> >::iterator iter = find_timer(str);
-  if(iter!=timers_.end()){
-    iter->second.start();
+  if (frames_in_slice_==frames_per_slice_)
+  {
+    cur_slice_ = (cur_slice_+1)%num_slices_;
+    frames_in_slice_ = 0;
+    for (size_t i=0; i<slice_hists_.size(); ++i)
+    {
+      slice_hists_[i][cur_slice_].reset();
+    }
   }
-  else
+  ++frames_in_slice_;
+  for (size_t i=0; i<frame_times_.size(); ++i)
   {
-    throw std::runtime_error("PerMon: Unknown type!");
+    if (frame_counts_[i]==0)
+      continue;
+    int64_t ns = static_cast<int64_t>(frame_times_[i]*1e9+0.5);
+    total_hists_[i].record(ns);
+    slice_hists_[i][cur_slice_].record(ns);
   }
 }
 
+PerformanceMonitor::TimerStats PerformanceMonitor
+::stats(const LatencyHistogram & hist)
+{
+  TimerStats s;
+  s.p50 = hist.percentile(50)*1e-9;
+  s.p95 = hist.percentile(95)*1e-9;
+  s.p99 = hist.percentile(99)*1e-9;
+  s.max = hist.max()*1e-9;
+  s.mean = hist.mean()*1e-9;
+  s.count = hist.count();
+  return s;
+}
+
+PerformanceMonitor::TimerStats PerformanceMonitor
+::window_stats(int handle) const
+{
+  LatencyHistogram hist;
+  for (int i=0; i<num_slices_; ++i)
+  {
+    hist.add(slice_hists_[handle][i]);
+  }
+  return stats(hist);
+}
+
+PerformanceMonitor::TimerStats PerformanceMonitor
+::total_stats(int handle) const
+{
+  return stats(total_hists_[handle]);
+}
+
 void PerformanceMonitor
-::stop(const std::string & str)
+::setup_tail_latency(pangolin::DataLog * log)
+{
+  vector<string> labels;
+  for (size_t i=0; i<names_.size(); ++i)
+  {
+    labels.push_back(names_[i] + " p50");
+    labels.push_back(names_[i] + " p95");
+    labels.push_back(names_[i] + " p99");
+    labels.push_back(names_[i] + " max");
+  }
+  log->SetLabels(labels);
+}
+
+void PerformanceMonitor
+::plot_tail_latency(pangolin::DataLog * log)
 {
-  list<pair<string, StopWatch> >::iterator iter = find_timer(str);
-  if(iter!=timers_.end()){
-    iter->second.stop();
+  vector<float> values;
+  for (size_t i=0; i<names_.size(); ++i)
+  {
+    TimerStats s = window_stats(i);
+    values.push_back(s.p50);
+    values.push_back(s.p95);
+    values.push_back(s.p99);
+    values.push_back(s.max);
   }
-  else
+  log->Log(values);
+}
+
+void PerformanceMonitor
+::start_trace(const std::string & filename, TraceWriter::Format format)
+{
+  stop_trace();
+  trace_writer_ = new TraceWriter(filename, format, names_);
+  trace_start_ns_ = frame_start_ns_;
+}
+
+void PerformanceMonitor
+::stop_trace()
+{
+  delete trace_writer_;
+  trace_writer_ = NULL;
+}
+
+//Only the accumulated time per call tree node is known, so within a frame
+//the children of a node are laid out one after another from its start.
+//Durations are exact, start times are not.
+void PerformanceMonitor
+::write_trace(int64_t frame_end_ns)
+{
+  TraceWriter::Record r;
+  r.frame = num_frames_;
+  r.start_ns = frame_start_ns_-trace_start_ns_;
+  r.duration_ns = frame_end_ns-frame_start_ns_;
+  r.timer = -1;
+  r.depth = 0;
+  r.count = 1;
+  r.reserved = 0;
+  trace_records_.clear();
+  trace_records_.push_back(r);
+
+  int64_t root_cursor = r.start_ns;
+  trace_starts_.resize(call_tree_.size());
+  trace_cursors_.resize(call_tree_.size());
+  trace_depths_.resize(call_tree_.size());
+  //parents are always before their children in call_tree_
+  for (size_t i=0; i<call_tree_.size(); ++i)
   {
-    throw std::runtime_error("PerMon: Unknown type!");
+    const CallNode & n = call_tree_[i];
+    int64_t duration = static_cast<int64_t>(n.frame_time*1e9+0.5);
+    int64_t & cursor = n.parent<0 ? root_cursor : trace_cursors_[n.parent];
+    trace_starts_[i] = cursor;
+    trace_cursors_[i] = cursor;
+    trace_depths_[i] = n.parent<0 ? 1 : trace_depths_[n.parent]+1;
+    cursor += duration;
+    if (n.frame_count==0)
+      continue;
+    r.start_ns = trace_starts_[i];
+    r.duration_ns = duration;
+    r.timer = n.timer;
+    r.depth = trace_depths_[i];
+    r.count = n.frame_count;
+    trace_records_.push_back(r);
   }
+  trace_writer_->push(&trace_records_[0], trace_records_.size());
 }
 
 void PerformanceMonitor
 ::plot(pangolin::DataLog * plot)
 {
-  double cost_cur_frame=0;
-  vector<float> time(timers_.size());
-  int i = 0;
-  for (list<pair<string, StopWatch> >::iterator iter=timers_.begin();
-       iter!=timers_.end(); ++iter)
+  vector<float> time(frame_times_.size());
+  for (size_t i=0; i<frame_times_.size(); ++i)
   {
-    double stopped_time = iter->second.get_stopped_time();
-    cost_cur_frame+=stopped_time ;
-    time[i] = stopped_time ;
-    ++i;
+    time[i] = frame_times_[i];
   }
   plot->Log(time);
 }
@@ -20,50 +20,193 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+
 #ifndef VISIONTOOLS_PERFORMANCE_MONITOR_H
 #define VISIONTOOLS_PERFORMANCE_MONITOR_H
 
+#include <pthread.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
 #include <pangolin/pangolin.h>
 
+#include "latency_histogram.h"
 #include "linear_camera.h"
-#include "ringbuffer.h"
 #include "stopwatch.h"
+#include "trace_writer.h"
+#include "windowed_stats.h"
 
 namespace VisionTools
 {
 
+//Hierarchical frame profiler. Timers are registered once with add(), which
+//returns an integer handle for start/stop (or Scope). Scopes which are
+//nested on the same thread form a call tree. Each thread records into its
+//own log without taking locks; the logs are merged in new_frame(), which
+//also frees the logs of threads that have exited.
+//
+//add() is expected to be called before the timers are used.
+//setup() is optional: the first frame starts with the constructor, so
+//headless code may just call new_frame() and start_trace().
+//start/stop may be called from any thread, but must be properly nested per
+//thread. new_frame, plot and the accessors must be called from one thread.
 class PerformanceMonitor
 {
 public:
+  //RAII helper: times the enclosing block
+  class Scope
+  {
+  public:
+    Scope(PerformanceMonitor * monitor, int handle)
+      : monitor_(monitor), handle_(handle)
+    {
+      monitor_->start(handle_);
+    }
+
+    ~Scope()
+    {
+      monitor_->stop(handle_);
+    }
+
+  private:
+    Scope(const Scope &);
+    Scope & operator=(const Scope &);
+
+    PerformanceMonitor * monitor_;
+    int handle_;
+  };
+
+  //node of the merged call tree; parent is -1 for top-level timers
+  struct CallNode
+  {
+    int timer;
+    int parent;
+    double frame_time;
+    double total_time;
+    long frame_count;
+    long total_count;
+  };
+
+  //per-timer latency statistics in seconds, over the frames in which the
+  //timer was used
+  struct TimerStats
+  {
+    double p50;
+    double p95;
+    double p99;
+    double max;
+    double mean;
+    long count;
+  };
+
   PerformanceMonitor();
+  ~PerformanceMonitor();
 
-  void
+  int
   add                        (const std::string & str);
   void
   new_frame                  ();
   void
+  start                      (int handle);
+  void
+  stop                       (int handle);
+  void
   start                      (const std::string & str);
   void
   stop                       (const std::string & str);
   void
   plot                       (pangolin::DataLog * plot);
-  void
+  void                       //restarts the current frame
+  setup                      ();
+  void                       //as setup(), and labels log with the timers
   setup                      (pangolin::DataLog * log);
+  int
+  handle                     (const std::string & str) const;
+  void                       //window: last frames_per_slice*num_slices frames
+  set_stats_window           (int frames_per_slice, int num_slices);
+  TimerStats
+  window_stats               (int handle) const;
+  TimerStats
+  total_stats                (int handle) const;
+  void
+  setup_tail_latency         (pangolin::DataLog * log);
+  void                       //logs windowed p50, p95, p99 and max per timer
+  plot_tail_latency          (pangolin::DataLog * log);
+  void                       //streams every frame's call tree to a file
+  start_trace                (const std::string & filename,
+                              TraceWriter::Format format);
+  void
+  stop_trace                 ();
 
   const float & fps() const
   {
     return fps_;
   }
 
+  //time in seconds spent in timer during the last completed frame,
+  //summed over all threads and call sites
+  double frame_time(int handle) const
+  {
+    return frame_times_[handle];
+  }
+
+  const std::vector<std::string> & names() const
+  {
+    return names_;
+  }
+
+  const std::vector<CallNode> & call_tree() const
+  {
+    return call_tree_;
+  }
+
 private:
+  struct ThreadLog;
+
+  PerformanceMonitor(const PerformanceMonitor &);
+  PerformanceMonitor & operator=(const PerformanceMonitor &);
+
+  ThreadLog *
+  thread_log                 ();
+  int
+  call_node                  (int parent, int timer);
+  void
+  merge                      (ThreadLog * log);
+  void
+  record_stats               ();
+  void
+  write_trace                (int64_t frame_end_ns);
+  static TimerStats
+  stats                      (const LatencyHistogram & hist);
+
   float fps_;
-  std::list<std::pair<std::string, StopWatch> >::iterator
-  find_timer                 (const std::string & str);
-  std::list<std::pair<std::string, StopWatch> > timers_;
-  //RingBuffer<std::vector<float> > ringbuffer_;
   std::vector<std::string> names_;
-  //int num_timers_;
+  std::map<std::string, int> handles_;
+  std::vector<double> frame_times_;
+  std::vector<long> frame_counts_;
+  std::vector<LatencyHistogram> total_hists_;
+  std::vector<std::vector<LatencyHistogram> > slice_hists_;
+  int frames_per_slice_;
+  int num_slices_;
+  int cur_slice_;
+  int frames_in_slice_;
+  std::vector<CallNode> call_tree_;
+  std::map<std::pair<int,int>, int> call_tree_index_;
+  std::vector<ThreadLog *> logs_;
+  pthread_key_t log_key_;
+  pthread_mutex_t logs_mutex_;
   StopWatch frame_timer_;
+  WindowedStats<double> frame_durations_;
+  long num_frames_;
+  int64_t frame_start_ns_;
+  TraceWriter * trace_writer_;
+  int64_t trace_start_ns_;
+  std::vector<TraceWriter::Record> trace_records_;
+  std::vector<int64_t> trace_starts_;
+  std::vector<int64_t> trace_cursors_;
+  std::vector<int> trace_depths_;
 };
 }
 
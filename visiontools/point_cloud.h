@@ -0,0 +1,319 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_POINT_CLOUD_H
+#define VISIONTOOLS_POINT_CLOUD_H
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "gl_data.h"
+
+namespace VisionTools
+{
+
+template <class SCALAR> struct GlScalarType;
+
+template <> struct GlScalarType<float>
+{
+  static GLenum type()
+  {
+    return GL_FLOAT;
+  }
+};
+
+template <> struct GlScalarType<double>
+{
+  static GLenum type()
+  {
+    return GL_DOUBLE;
+  }
+};
+
+//Point cloud with one contiguous array per attribute (positions, optional
+//RGBA colors and normals, further named attributes). Each array is exposed
+//as Eigen::Map (one column per point) for computation and as raw pointer
+//for glVertexPointer & co, so drawing needs no conversion into GlPoint3f.
+//SCALAR is float or double; colors are always float.
+template <class SCALAR>
+class PointCloud
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef Matrix<SCALAR,3,Dynamic> Matrix3X;
+  typedef Matrix<SCALAR,Dynamic,Dynamic> MatrixX;
+  typedef Matrix<SCALAR,3,1> Vector3;
+
+  PointCloud()
+    : size_(0),
+      has_colors_(false),
+      has_normals_(false),
+      default_color_(1,1,1,1)
+  {
+  }
+
+  int size() const
+  {
+    return size_;
+  }
+
+  void
+  resize                     (int num);
+  void
+  reserve                    (int num);
+  void
+  clear                      ();
+  void
+  push_back                  (const Vector3 & xyz);
+
+  template <class Derived>
+  void setXyz(const MatrixBase<Derived> & xyz)
+  {
+    resize(xyz.cols());
+    this->xyz() = xyz.template cast<SCALAR>();
+  }
+
+  //colors and normals exist once enabled, for all points; new points get
+  //color and zero normals
+  void
+  enableColors               (const Vector4f & color = Vector4f(1,1,1,1));
+  void
+  enableNormals              ();
+  int                        //index for attribute()
+  addAttribute               (const std::string & name,
+                              int dim);
+  int                        //-1 if there is no such attribute
+  attributeIndex             (const std::string & name) const;
+
+  bool has_colors() const
+  {
+    return has_colors_;
+  }
+
+  bool has_normals() const
+  {
+    return has_normals_;
+  }
+
+  Map<Matrix3X> xyz()
+  {
+    return Map<Matrix3X>(data(xyz_), 3, size_);
+  }
+
+  Map<const Matrix3X> xyz() const
+  {
+    return Map<const Matrix3X>(data(xyz_), 3, size_);
+  }
+
+  Map<Matrix4Xf> colors()
+  {
+    assert(has_colors_);
+    return Map<Matrix4Xf>(data(rgba_), 4, size_);
+  }
+
+  Map<const Matrix4Xf> colors() const
+  {
+    assert(has_colors_);
+    return Map<const Matrix4Xf>(data(rgba_), 4, size_);
+  }
+
+  Map<Matrix3X> normals()
+  {
+    assert(has_normals_);
+    return Map<Matrix3X>(data(normals_), 3, size_);
+  }
+
+  Map<const Matrix3X> normals() const
+  {
+    assert(has_normals_);
+    return Map<const Matrix3X>(data(normals_), 3, size_);
+  }
+
+  Map<MatrixX> attribute(int i)
+  {
+    return Map<MatrixX>(data(attributes_[i].values),
+                        attributes_[i].dim, size_);
+  }
+
+  Map<const MatrixX> attribute(int i) const
+  {
+    return Map<const MatrixX>(data(attributes_[i].values),
+                              attributes_[i].dim, size_);
+  }
+
+  //pointers for gl*Pointer with stride 0
+  const SCALAR * xyz_data() const
+  {
+    return data(xyz_);
+  }
+
+  const float * color_data() const
+  {
+    return data(rgba_);
+  }
+
+  const SCALAR * normal_data() const
+  {
+    return data(normals_);
+  }
+
+  static GLenum gl_type()
+  {
+    return GlScalarType<SCALAR>::type();
+  }
+
+private:
+  struct Attribute
+  {
+    std::string name;
+    int dim;
+    vector<SCALAR> values;
+  };
+
+  template <class T>
+  static T * data(vector<T> & v)
+  {
+    return v.empty() ? NULL : &v[0];
+  }
+
+  template <class T>
+  static const T * data(const vector<T> & v)
+  {
+    return v.empty() ? NULL : &v[0];
+  }
+
+  int size_;
+  bool has_colors_;
+  bool has_normals_;
+  Vector4f default_color_;
+  vector<SCALAR> xyz_;
+  vector<float> rgba_;
+  vector<SCALAR> normals_;
+  vector<Attribute> attributes_;
+};
+
+template <class SCALAR>
+void PointCloud<SCALAR>
+::resize(int num)
+{
+  int old_size = size_;
+  size_ = num;
+  xyz_.resize(3*num);
+  if (has_colors_)
+  {
+    rgba_.resize(4*num);
+    for (int i=old_size; i<num; ++i)
+    {
+      Map<Vector4f> rgba(&rgba_[4*i]);
+      rgba = default_color_;
+    }
+  }
+  if (has_normals_)
+    normals_.resize(3*num, SCALAR(0));
+  for (size_t a=0; a<attributes_.size(); ++a)
+  {
+    attributes_[a].values.resize(attributes_[a].dim*num, SCALAR(0));
+  }
+}
+
+template <class SCALAR>
+void PointCloud<SCALAR>
+::reserve(int num)
+{
+  xyz_.reserve(3*num);
+  if (has_colors_)
+    rgba_.reserve(4*num);
+  if (has_normals_)
+    normals_.reserve(3*num);
+  for (size_t a=0; a<attributes_.size(); ++a)
+  {
+    attributes_[a].values.reserve(attributes_[a].dim*num);
+  }
+}
+
+template <class SCALAR>
+void PointCloud<SCALAR>
+::clear()
+{
+  resize(0);
+}
+
+template <class SCALAR>
+void PointCloud<SCALAR>
+::push_back(const Vector3 & xyz)
+{
+  resize(size_+1);
+  this->xyz().col(size_-1) = xyz;
+}
+
+template <class SCALAR>
+void PointCloud<SCALAR>
+::enableColors(const Vector4f & color)
+{
+  default_color_ = color;
+  if (has_colors_)
+    return;
+  has_colors_ = true;
+  rgba_.resize(4*size_);
+  colors().colwise() = color;
+}
+
+template <class SCALAR>
+void PointCloud<SCALAR>
+::enableNormals()
+{
+  if (has_normals_)
+    return;
+  has_normals_ = true;
+  normals_.resize(3*size_, SCALAR(0));
+}
+
+template <class SCALAR>
+int PointCloud<SCALAR>
+::addAttribute(const std::string & name, int dim)
+{
+  assert(attributeIndex(name)<0);
+  Attribute attribute;
+  attribute.name = name;
+  attribute.dim = dim;
+  attribute.values.resize(dim*size_, SCALAR(0));
+  attributes_.push_back(attribute);
+  return attributes_.size()-1;
+}
+
+template <class SCALAR>
+int PointCloud<SCALAR>
+::attributeIndex(const std::string & name) const
+{
+  for (size_t a=0; a<attributes_.size(); ++a)
+  {
+    if (attributes_[a].name==name)
+      return a;
+  }
+  return -1;
+}
+
+}
+
+#endif
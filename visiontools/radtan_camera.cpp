@@ -0,0 +1,77 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#include "radtan_camera.h"
+
+namespace VisionTools
+{
+
+RadTanCamera
+::RadTanCamera(const double & focal_length,
+               const Vector2d & principle_point,
+               const cv::Size & size,
+               const Vector5d & dist_coeffs)
+  : DistortedCamera(focal_length, principle_point, size),
+    dist_coeffs_(dist_coeffs)
+{
+}
+
+Vector2d RadTanCamera
+::distort(const Vector2d& undist) const
+{
+  double k1 = dist_coeffs_[0];
+  double k2 = dist_coeffs_[1];
+  double p1 = dist_coeffs_[2];
+  double p2 = dist_coeffs_[3];
+  double k3 = dist_coeffs_[4];
+  double x = undist[0];
+  double y = undist[1];
+  double r2 = x*x + y*y;
+  double radial = 1. + r2*(k1 + r2*(k2 + r2*k3));
+  return Vector2d(x*radial + 2.*p1*x*y + p2*(r2 + 2.*x*x),
+                  y*radial + p1*(r2 + 2.*y*y) + 2.*p2*x*y);
+}
+
+Matrix2d RadTanCamera
+::distortJacobian(const Vector2d& undist) const
+{
+  double k1 = dist_coeffs_[0];
+  double k2 = dist_coeffs_[1];
+  double p1 = dist_coeffs_[2];
+  double p2 = dist_coeffs_[3];
+  double k3 = dist_coeffs_[4];
+  double x = undist[0];
+  double y = undist[1];
+  double r2 = x*x + y*y;
+  double radial = 1. + r2*(k1 + r2*(k2 + r2*k3));
+  double d_radial = k1 + r2*(2.*k2 + 3.*k3*r2);   //d radial / d r2
+  double off_diag = 2.*x*y*d_radial + 2.*p1*x + 2.*p2*y;
+  Matrix2d J;
+  J(0,0) = radial + 2.*x*x*d_radial + 2.*p1*y + 6.*p2*x;
+  J(0,1) = off_diag;
+  J(1,0) = off_diag;
+  J(1,1) = radial + 2.*y*y*d_radial + 6.*p1*y + 2.*p2*x;
+  return J;
+}
+
+}
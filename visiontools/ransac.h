@@ -0,0 +1,481 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#ifndef VISIONTOOLS_RANSAC_H
+#define VISIONTOOLS_RANSAC_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include <Eigen/Core>
+
+#include "sample.h"
+
+namespace VisionTools
+{
+using namespace std;
+
+struct RansacParams
+{
+  RansacParams()
+    : threshold(1.),
+      confidence(0.99),
+      max_iterations(1000),
+      batch_size(64),
+      local_optimization(true),
+      lo_iterations(4),
+      prosac(false),
+      sprt(false),
+      sprt_epsilon(0.1),
+      sprt_delta(0.05),
+      sprt_fit_cost(200.),
+      seed(0)
+  {
+  }
+
+  //data point i is an inlier if problem.error(model, i)<threshold
+  double threshold;
+  //probability of having drawn at least one all-inlier sample
+  double confidence;
+  int max_iterations;
+  //hypotheses generated and scored in parallel before the termination
+  //criterion is re-evaluated
+  int batch_size;
+  //refit to the inliers of each new best model (LO-RANSAC)
+  bool local_optimization;
+  int lo_iterations;
+  //data is sorted by decreasing quality, draw from growing prefixes
+  bool prosac;
+  //Wald's sequential probability ratio test, aborts scoring bad models
+  //early. epsilon and delta are initial guesses of the inlier ratio and the
+  //probability of a data point being consistent with a bad model.
+  bool sprt;
+  double sprt_epsilon;
+  double sprt_delta;
+  //time of one model fit in units of a single error evaluation
+  double sprt_fit_cost;
+  uint64_t seed;
+};
+
+//Problem interface:
+//
+//  typedef ... Model;
+//  int num_data() const;
+//  int sample_size() const;
+//  //minimal (num==sample_size()) or non-minimal (local optimisation) fit;
+//  //may append zero or more models
+//  void fit(const int * ids, int num,
+//           vector<Model, aligned_allocator<Model> > * models) const;
+//  double error(const Model & model, int i) const;
+//
+//Results are deterministic for a given seed regardless of the number of
+//threads: hypothesis t always uses RandomEngine(seed, t) and batches are
+//reduced in hypothesis order.
+template <class Problem>
+class Ransac
+{
+public:
+  typedef typename Problem::Model Model;
+  typedef vector<Model, Eigen::aligned_allocator<Model> > ModelVector;
+
+  Ransac                     (const RansacParams & params = RansacParams())
+    : params_(params), num_iterations_(0)
+  {
+  }
+
+  bool
+  estimate                   (const Problem & problem,
+                              Model * model,
+                              vector<int> * inliers = NULL);
+
+  int num_iterations() const
+  {
+    return num_iterations_;
+  }
+
+  const RansacParams & params() const
+  {
+    return params_;
+  }
+
+  static int
+  requiredIterations         (double inlier_ratio,
+                              int sample_size,
+                              double confidence);
+
+private:
+  struct Sprt
+  {
+    double epsilon;
+    double delta;
+    double threshold;
+  };
+
+  void
+  updateSprt                 (double models_per_sample);
+
+  int
+  score                      (const Problem & problem,
+                              const Model & model,
+                              const vector<int> & order,
+                              int * num_tested) const;
+
+  int
+  localOptimization          (const Problem & problem,
+                              int num_inliers,
+                              Model * model) const;
+
+  void
+  findInliers                (const Problem & problem,
+                              const Model & model,
+                              vector<int> * inliers) const;
+
+  void
+  prosacSchedule             (int num_data,
+                              int sample_size,
+                              int num_hypotheses,
+                              vector<int> * prefix_sizes) const;
+
+  RansacParams params_;
+  Sprt sprt_;
+  int num_iterations_;
+};
+
+template <class Problem>
+int Ransac<Problem>
+::requiredIterations(double inlier_ratio, int sample_size,
+                     double confidence)
+{
+  double p_good = std::pow(inlier_ratio, sample_size);
+  if (p_good<=0.)
+    return numeric_limits<int>::max();
+  if (p_good>=1.)
+    return 1;
+  double n = std::log(1.-confidence)/std::log(1.-p_good);
+  if (n>=numeric_limits<int>::max())
+    return numeric_limits<int>::max();
+  return std::max(1, static_cast<int>(std::ceil(n)));
+}
+
+//Decision threshold A of the SPRT, from A = t_M*C/m_S + 1 + ln A
+//(Matas & Chum, "Randomized RANSAC with Sequential Probability Ratio Test")
+template <class Problem>
+void Ransac<Problem>
+::updateSprt(double models_per_sample)
+{
+  double eps = sprt_.epsilon;
+  double delta = sprt_.delta;
+  double C = (1.-delta)*std::log((1.-delta)/(1.-eps))
+      + delta*std::log(delta/eps);
+  double K = params_.sprt_fit_cost*C/std::max(models_per_sample, 1.);
+  double A = K+1.;
+  for (int i=0; i<10; ++i)
+  {
+    double A_new = K+1.+std::log(A);
+    if (std::abs(A_new-A)<1e-4)
+    {
+      A = A_new;
+      break;
+    }
+    A = A_new;
+  }
+  sprt_.threshold = A;
+}
+
+//Number of inliers among the first *num_tested points of order; the SPRT
+//rejected the model if *num_tested<order.size()
+template <class Problem>
+int Ransac<Problem>
+::score(const Problem & problem, const Model & model,
+        const vector<int> & order, int * num_tested) const
+{
+  int n = order.size();
+  int num_inliers = 0;
+  if (!params_.sprt)
+  {
+    for (int i=0; i<n; ++i)
+    {
+      if (problem.error(model, i)<params_.threshold)
+        ++num_inliers;
+    }
+    *num_tested = n;
+    return num_inliers;
+  }
+
+  double lambda = 1.;
+  double lambda_in = sprt_.delta/sprt_.epsilon;
+  double lambda_out = (1.-sprt_.delta)/(1.-sprt_.epsilon);
+  for (int i=0; i<n; ++i)
+  {
+    if (problem.error(model, order[i])<params_.threshold)
+    {
+      ++num_inliers;
+      lambda *= lambda_in;
+    }
+    else
+    {
+      lambda *= lambda_out;
+    }
+    if (lambda>sprt_.threshold)
+    {
+      *num_tested = i+1;
+      return num_inliers;
+    }
+  }
+  *num_tested = n;
+  return num_inliers;
+}
+
+template <class Problem>
+void Ransac<Problem>
+::findInliers(const Problem & problem, const Model & model,
+              vector<int> * inliers) const
+{
+  inliers->clear();
+  int n = problem.num_data();
+  for (int i=0; i<n; ++i)
+  {
+    if (problem.error(model, i)<params_.threshold)
+      inliers->push_back(i);
+  }
+}
+
+template <class Problem>
+int Ransac<Problem>
+::localOptimization(const Problem & problem, int num_inliers,
+                    Model * model) const
+{
+  vector<int> inliers;
+  ModelVector models;
+  int n = problem.num_data();
+  for (int it=0; it<params_.lo_iterations; ++it)
+  {
+    findInliers(problem, *model, &inliers);
+    if (static_cast<int>(inliers.size())<=problem.sample_size())
+      break;
+    models.clear();
+    problem.fit(&inliers[0], inliers.size(), &models);
+    bool improved = false;
+    for (size_t m=0; m<models.size(); ++m)
+    {
+      int count = 0;
+#pragma omp parallel for reduction(+:count)
+      for (int i=0; i<n; ++i)
+      {
+        if (problem.error(models[m], i)<params_.threshold)
+          ++count;
+      }
+      if (count>num_inliers)
+      {
+        num_inliers = count;
+        *model = models[m];
+        improved = true;
+      }
+    }
+    if (!improved)
+      break;
+  }
+  return num_inliers;
+}
+
+//Prefix size n_t of hypothesis t for PROSAC (Chum & Matas, "Matching with
+//PROSAC"). Hypotheses with a prefix size of -n_t draw sample_size-1 points
+//out of the first n_t-1 and always include point n_t-1.
+template <class Problem>
+void Ransac<Problem>
+::prosacSchedule(int num_data, int sample_size, int num_hypotheses,
+                 vector<int> * prefix_sizes) const
+{
+  prefix_sizes->resize(num_hypotheses);
+  int m = sample_size;
+  int n = m;
+  double T_n = params_.max_iterations;
+  for (int i=0; i<m; ++i)
+    T_n *= static_cast<double>(m-i)/(num_data-i);
+  double T_n_prime = 1.;
+  for (int t=1; t<=num_hypotheses; ++t)
+  {
+    if (t>T_n_prime && n<num_data)
+    {
+      double T_n_next = T_n*(n+1)/(n+1-m);
+      T_n_prime += std::ceil(T_n_next-T_n);
+      T_n = T_n_next;
+      ++n;
+    }
+    (*prefix_sizes)[t-1] = (T_n_prime<t || n==num_data) ? n : -n;
+  }
+}
+
+template <class Problem>
+bool Ransac<Problem>
+::estimate(const Problem & problem, Model * model, vector<int> * inliers)
+{
+  int num_data = problem.num_data();
+  int sample_size = problem.sample_size();
+  num_iterations_ = 0;
+  if (num_data<sample_size || sample_size<=0)
+    return false;
+
+  sprt_.epsilon = params_.sprt_epsilon;
+  sprt_.delta = params_.sprt_delta;
+  updateSprt(1.);
+
+  //SPRT evaluates points in random order so that sorted (PROSAC) data
+  //does not bias the likelihood ratio
+  vector<int> order(num_data);
+  for (int i=0; i<num_data; ++i)
+    order[i] = i;
+  if (params_.sprt)
+  {
+    RandomEngine rng(params_.seed, numeric_limits<uint64_t>::max());
+    for (int i=num_data-1; i>0; --i)
+      std::swap(order[i], order[rng.uniform(0, i)]);
+  }
+
+  vector<int> prefix_sizes;
+  if (params_.prosac)
+    prosacSchedule(num_data, sample_size, params_.max_iterations,
+                   &prefix_sizes);
+
+  int batch_size = std::max(1, params_.batch_size);
+  ModelVector batch_models(batch_size);
+  vector<int> batch_scores(batch_size);
+  vector<int> batch_num_models(batch_size);
+  vector<int> batch_num_rejected(batch_size);
+  vector<double> batch_rejected_ratio(batch_size);
+
+  int best_score = -1;
+  int max_iterations = params_.max_iterations;
+  int num_models = 0;
+
+  while (num_iterations_<max_iterations)
+  {
+    int begin = num_iterations_;
+    int num = std::min(batch_size, max_iterations-begin);
+
+#pragma omp parallel
+    {
+      vector<int> sample(sample_size);
+      ModelVector models;
+#pragma omp for schedule(dynamic)
+      for (int b=0; b<num; ++b)
+      {
+        int t = begin+b;
+        RandomEngine rng(params_.seed, t);
+        if (params_.prosac && prefix_sizes[t]<0)
+        {
+          int n = -prefix_sizes[t];
+          rng.subset(n-1, sample_size-1, &sample[0]);
+          sample[sample_size-1] = n-1;
+        }
+        else
+        {
+          int n = params_.prosac ? prefix_sizes[t] : num_data;
+          rng.subset(n, sample_size, &sample[0]);
+        }
+        models.clear();
+        problem.fit(&sample[0], sample_size, &models);
+        batch_scores[b] = -1;
+        batch_num_models[b] = models.size();
+        batch_num_rejected[b] = 0;
+        batch_rejected_ratio[b] = 0.;
+        for (size_t m=0; m<models.size(); ++m)
+        {
+          int num_tested;
+          int s = score(problem, models[m], order, &num_tested);
+          if (num_tested<num_data)
+          {
+            ++batch_num_rejected[b];
+            batch_rejected_ratio[b] += static_cast<double>(s)/num_tested;
+            continue;
+          }
+          if (s>batch_scores[b])
+          {
+            batch_scores[b] = s;
+            batch_models[b] = models[m];
+          }
+        }
+      }
+    }
+
+    int num_rejected = 0;
+    double rejected_ratio = 0;
+    for (int b=0; b<num; ++b)
+    {
+      num_models += batch_num_models[b];
+      num_rejected += batch_num_rejected[b];
+      rejected_ratio += batch_rejected_ratio[b];
+      if (batch_scores[b]>best_score)
+      {
+        best_score = batch_scores[b];
+        *model = batch_models[b];
+        if (params_.local_optimization)
+          best_score = localOptimization(problem, best_score, model);
+      }
+    }
+    num_iterations_ += num;
+
+    if (best_score<0)
+      continue;
+    double inlier_ratio = static_cast<double>(best_score)/num_data;
+    max_iterations
+        = std::min(params_.max_iterations,
+                   requiredIterations(inlier_ratio, sample_size,
+                                      params_.confidence));
+    if (params_.sprt)
+    {
+      //delta is re-estimated as the mean fraction of consistent points
+      //among rejected models
+      bool changed = false;
+      if (inlier_ratio>sprt_.epsilon)
+      {
+        sprt_.epsilon = inlier_ratio;
+        changed = true;
+      }
+      if (num_rejected>0)
+      {
+        double delta = std::min(0.5*sprt_.epsilon,
+                                std::max(1e-4, rejected_ratio/num_rejected));
+        if (std::abs(delta-sprt_.delta)>0.05*sprt_.delta)
+        {
+          sprt_.delta = delta;
+          changed = true;
+        }
+      }
+      if (changed)
+        updateSprt(static_cast<double>(num_models)/num_iterations_);
+    }
+  }
+
+  if (best_score<sample_size)
+    return false;
+  if (inliers!=NULL)
+    findInliers(problem, *model, inliers);
+  return true;
+}
+
+}
+
+#endif
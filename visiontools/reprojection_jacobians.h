@@ -0,0 +1,153 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#ifndef VISIONTOOLS_REPROJECTION_JACOBIANS_H
+#define VISIONTOOLS_REPROJECTION_JACOBIANS_H
+
+#include <vector>
+
+#include <Eigen/StdVector>
+
+#include <sophus/se3.h>
+
+#include "camera_model.h"
+
+namespace VisionTools
+{
+using namespace Sophus;
+
+//Residuals and jacobians of many reprojection observations, ready to be
+//copied into a sparse solver. For observation k:
+//
+//  residual k:   residuals->col(k)              = map(T_cw*xyz_w) - obs_k
+//  pose block:   J_pose->block<2,6>(0,6*k)      (d residual / d delta)
+//  point block:  J_point->block<2,3>(0,3*k)     (d residual / d xyz_w)
+//
+//with the pose perturbed from the left, T_cw <- exp(delta)*T_cw and
+//delta = (translation, rotation) as in Sophus. Each 2x6 and 2x3 block is
+//contiguous in memory. Any of the output pointers may be NULL.
+//Returns the sum of squared residuals.
+
+inline void
+setReprojectionBlocks(const Matrix<double,2,3> & J_xyz,
+                      const Vector3d & xyz_cam,
+                      const Matrix3d & R_cw,
+                      double * J_pose,
+                      double * J_point)
+{
+  if (J_pose!=NULL)
+  {
+    Map<Matrix<double,2,6> > J(J_pose);
+    J.block<2,3>(0,0) = J_xyz;
+    //J_xyz * (-[xyz_cam]_x), expanded
+    const double x = xyz_cam[0];
+    const double y = xyz_cam[1];
+    const double z = xyz_cam[2];
+    for (int r=0; r<2; ++r)
+    {
+      J(r,3) = J_xyz(r,2)*y - J_xyz(r,1)*z;
+      J(r,4) = J_xyz(r,0)*z - J_xyz(r,2)*x;
+      J(r,5) = J_xyz(r,1)*x - J_xyz(r,0)*y;
+    }
+  }
+  if (J_point!=NULL)
+  {
+    Map<Matrix<double,2,3> > J(J_point);
+    J = J_xyz*R_cw;
+  }
+}
+
+//Observations of points xyz_world.col(point_ids[k]) in poses
+//T_cw_vec[pose_ids[k]], with measurement obs.col(k).
+template <class Cam>
+double
+linearizeReprojection(const Cam & cam,
+                      const vector<SE3, aligned_allocator<SE3> > & T_cw_vec,
+                      const Matrix3Xd & xyz_world,
+                      const vector<int> & pose_ids,
+                      const vector<int> & point_ids,
+                      const Matrix2Xd & obs,
+                      Matrix2Xd * residuals,
+                      Matrix2Xd * J_pose,
+                      Matrix2Xd * J_point)
+{
+  int num_obs = obs.cols();
+  assert(static_cast<int>(pose_ids.size())==num_obs);
+  assert(static_cast<int>(point_ids.size())==num_obs);
+
+  int num_poses = T_cw_vec.size();
+  vector<Matrix3d> R_cw_vec(num_poses);
+  vector<Vector3d> t_cw_vec(num_poses);
+  for (int i=0; i<num_poses; ++i)
+  {
+    R_cw_vec[i] = T_cw_vec[i].rotation_matrix();
+    t_cw_vec[i] = T_cw_vec[i].translation();
+  }
+
+  if (residuals!=NULL)
+    residuals->resize(2, num_obs);
+  if (J_pose!=NULL)
+    J_pose->resize(2, 6*num_obs);
+  if (J_point!=NULL)
+    J_point->resize(2, 3*num_obs);
+
+  double chi2 = 0;
+#pragma omp parallel for reduction(+:chi2) if(num_obs>1000)
+  for (int k=0; k<num_obs; ++k)
+  {
+    const Matrix3d & R_cw = R_cw_vec[pose_ids[k]];
+    Vector3d xyz_cam = R_cw*xyz_world.col(point_ids[k]) + t_cw_vec[pose_ids[k]];
+    Vector2d r = reprojectionError(cam, xyz_cam, Vector2d(obs.col(k)));
+    chi2 += r.squaredNorm();
+    if (residuals!=NULL)
+      residuals->col(k) = r;
+    setReprojectionBlocks(project3dJacobian(cam, xyz_cam),
+                          xyz_cam,
+                          R_cw,
+                          J_pose==NULL ? NULL : J_pose->data()+12*k,
+                          J_point==NULL ? NULL : J_point->data()+6*k);
+  }
+  return chi2;
+}
+
+//Single pose version, e.g. for motion-only tracking.
+template <class Cam>
+double
+linearizeReprojection(const Cam & cam,
+                      const SE3 & T_cw,
+                      const Matrix3Xd & xyz_world,
+                      const vector<int> & point_ids,
+                      const Matrix2Xd & obs,
+                      Matrix2Xd * residuals,
+                      Matrix2Xd * J_pose,
+                      Matrix2Xd * J_point)
+{
+  vector<SE3, aligned_allocator<SE3> > T_cw_vec(1, T_cw);
+  vector<int> pose_ids(point_ids.size(), 0);
+  return linearizeReprojection(cam, T_cw_vec, xyz_world, pose_ids, point_ids,
+                               obs, residuals, J_pose, J_point);
+}
+
+}
+
+#endif
@@ -38,10 +38,10 @@ public:
   void
   push_back                  (const T & elem);
 
-  T
-  get                        (int i);
+  const T &
+  get                        (int i) const;
 
-  int size()
+  int size() const
   {
     return num_elem_;
   }
@@ -75,18 +75,22 @@ void RingBuffer<T>
     num_elem_++;
   }
   else{
-    end_ = (end_+1)%arr_size_;
-    begin_ = (begin_+1)%arr_size_;
+    end_ = begin_;
+    if (++begin_==arr_size_)
+      begin_ = 0;
     arr_[end_] = elem;
   }
 }
 
 template <class T>
-T RingBuffer<T>
-::get(int i)
+const T & RingBuffer<T>
+::get(int i) const
 {
   assert(i<num_elem_);
-  return arr_[(begin_+i)%arr_size_];
+  int idx = begin_+i;
+  if (idx>=arr_size_)
+    idx -= arr_size_;
+  return arr_[idx];
 }
 
 }
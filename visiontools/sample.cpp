@@ -20,37 +20,316 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+
+#include <pthread.h>
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
 #include "sample.h"
 
 namespace VisionTools
 {
   using namespace std;
 
-  tr1::ranlux_base_01 Sample::gen_real;
-  tr1::mt19937 Sample::gen_int;
+  namespace
+  {
+    uint64_t splitmix64(uint64_t * x)
+    {
+      uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+    }
+
+    const double TWO_PI = 6.283185307179586;
+
+    //Insert-only set of non-negative ints with open addressing, sized for
+    //a known number of elements; O(num) setup, independent of the range.
+    class IdSet
+    {
+    public:
+      explicit IdSet(int num)
+      {
+        size_t size = 1;
+        while (size<2*static_cast<size_t>(num))
+          size <<= 1;
+        slots_.assign(size, -1);
+        mask_ = size-1;
+      }
+
+      //false if id was already in the set
+      bool insert(int id)
+      {
+        size_t i = (static_cast<uint32_t>(id)*2654435769u) & mask_;
+        while (slots_[i]>=0)
+        {
+          if (slots_[i]==id)
+            return false;
+          i = (i+1) & mask_;
+        }
+        slots_[i] = id;
+        return true;
+      }
+
+    private:
+      vector<int> slots_;
+      size_t mask_;
+    };
+
+    pthread_once_t engine_once = PTHREAD_ONCE_INIT;
+    pthread_key_t engine_key;
+    uint64_t base_seed = 0;
+    uint64_t next_stream = 0;
+
+    void deleteEngine(void * engine)
+    {
+      delete static_cast<RandomEngine *>(engine);
+    }
+
+    void createEngineKey()
+    {
+      pthread_key_create(&engine_key, &deleteEngine);
+    }
+  }
+
+  Sample::RealGenerator Sample::gen_real;
+  Sample::IntGenerator Sample::gen_int;
+
+  RandomEngine
+  ::RandomEngine(uint64_t seed, uint64_t stream)
+  {
+    this->seed(seed, stream);
+  }
+
+  void RandomEngine
+  ::seed(uint64_t seed, uint64_t stream)
+  {
+    uint64_t x = stream;
+    x = seed ^ splitmix64(&x);
+    for (int i=0; i<4; ++i)
+    {
+      s_[i] = splitmix64(&x);
+    }
+  }
+
+  double RandomEngine
+  ::gaussian(double sigma)
+  {
+    double u1 = 1.-uniform();
+    double u2 = uniform();
+    return sigma*std::sqrt(-2.*std::log(u1))*std::cos(TWO_PI*u2);
+  }
+
+  void RandomEngine
+  ::uniform(int from, int to, int num, int * samples)
+  {
+    for (int i=0; i<num; ++i)
+    {
+      samples[i] = uniform(from, to);
+    }
+  }
+
+  void RandomEngine
+  ::uniform(int num, double * samples)
+  {
+    for (int i=0; i<num; ++i)
+    {
+      samples[i] = uniform();
+    }
+  }
+
+  //Box-Muller on pairs of uniforms; the transform loop has no dependency
+  //on the generator state and is vectorisable.
+  void RandomEngine
+  ::gaussian(double sigma, int num, double * samples)
+  {
+    uniform(num, samples);
+    int num_pairs = num/2;
+#pragma omp simd
+    for (int i=0; i<num_pairs; ++i)
+    {
+      double r = sigma*std::sqrt(-2.*std::log(1.-samples[2*i]));
+      double phi = TWO_PI*samples[2*i+1];
+      samples[2*i] = r*std::cos(phi);
+      samples[2*i+1] = r*std::sin(phi);
+    }
+    if (num%2==1)
+    {
+      samples[num-1] = gaussian(sigma);
+    }
+  }
+
+  //Floyd's algorithm: exactly k draws. Membership is a linear scan for
+  //small k and a hash set of size O(k) otherwise, so the cost does not
+  //depend on n.
+  void RandomEngine
+  ::subset(int n, int k, int * ids)
+  {
+    assert(k>=0 && k<=n);
+    if (k<=64)
+    {
+      for (int i=0, j=n-k; i<k; ++i, ++j)
+      {
+        int t = uniform(0, j);
+        if (std::find(ids, ids+i, t)!=ids+i)
+          t = j;
+        ids[i] = t;
+      }
+      return;
+    }
+    IdSet taken(k);
+    for (int i=0, j=n-k; i<k; ++i, ++j)
+    {
+      int t = uniform(0, j);
+      //j has not been drawn yet: all earlier draws are smaller than j
+      if (!taken.insert(t))
+      {
+        t = j;
+        taken.insert(t);
+      }
+      ids[i] = t;
+    }
+  }
+
+  void RandomEngine
+  ::subset(int k, vector<int> * pool)
+  {
+    int n = pool->size();
+    assert(k>=0 && k<=n);
+    for (int i=0; i<k; ++i)
+    {
+      std::swap((*pool)[i], (*pool)[uniform(i, n-1)]);
+    }
+  }
+
+  AliasTable
+  ::AliasTable(const vector<double> & weights)
+  {
+    init(weights.empty() ? NULL : &weights[0], weights.size());
+  }
+
+  //An empty weight vector gives an empty table, which must not be sampled.
+  void AliasTable
+  ::init(const double * weights, int n)
+  {
+    prob_.resize(n);
+    alias_.resize(n);
+    if (n==0)
+      return;
+    double sum = 0.;
+    for (int i=0; i<n; ++i)
+    {
+      assert(weights[i]>=0.);
+      sum += weights[i];
+    }
+    assert(sum>0. && "AliasTable: all weights are zero");
+    vector<int> small;
+    vector<int> large;
+    small.reserve(n);
+    large.reserve(n);
+    for (int i=0; i<n; ++i)
+    {
+      prob_[i] = weights[i]*n/sum;
+      alias_[i] = i;
+      if (prob_[i]<1.)
+        small.push_back(i);
+      else
+        large.push_back(i);
+    }
+    while (!small.empty() && !large.empty())
+    {
+      int s = small.back();
+      small.pop_back();
+      int l = large.back();
+      alias_[s] = l;
+      prob_[l] -= 1.-prob_[s];
+      if (prob_[l]<1.)
+      {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    //left overs are 1 up to rounding
+    for (size_t i=0; i<small.size(); ++i)
+      prob_[small[i]] = 1.;
+    for (size_t i=0; i<large.size(); ++i)
+      prob_[large[i]] = 1.;
+  }
+
+  void AliasTable
+  ::sample(RandomEngine * rng, int num, int * ids) const
+  {
+    for (int i=0; i<num; ++i)
+    {
+      ids[i] = sample(rng);
+    }
+  }
+
+  RandomEngine & Sample
+  ::engine()
+  {
+    pthread_once(&engine_once, &createEngineKey);
+    RandomEngine * engine
+        = static_cast<RandomEngine *>(pthread_getspecific(engine_key));
+    if (engine==NULL)
+    {
+      uint64_t stream = __atomic_fetch_add(&next_stream, 1, __ATOMIC_RELAXED);
+      engine = new RandomEngine(__atomic_load_n(&base_seed, __ATOMIC_RELAXED),
+                                stream);
+      pthread_setspecific(engine_key, engine);
+    }
+    return *engine;
+  }
+
+  void Sample
+  ::seed(uint64_t seed)
+  {
+    __atomic_store_n(&base_seed, seed, __ATOMIC_RELAXED);
+    __atomic_store_n(&next_stream, 1, __ATOMIC_RELAXED);
+    engine().seed(seed, 0);
+  }
 
   int Sample
   ::uniform(int from, int to)
   {
-    tr1::uniform_int<int> unif(from, to);
-    int sample = unif(gen_int);
-    return sample;
+    return engine().uniform(from, to);
   }
 
   double Sample
   ::uniform()
   {
-    tr1::uniform_real<double> unif(0.0, 1.0);
-    double sample = unif(gen_real);
-    return sample;
+    return engine().uniform();
   }
 
   double Sample
   ::gaussian(double sigma)
   {
-    tr1::normal_distribution<double> gauss(0.0, sigma);
-    double sample = gauss(gen_real);
-    return sample;
+    return engine().gaussian(sigma);
+  }
+
+  void Sample
+  ::uniform(int from, int to, int num, int * samples)
+  {
+    engine().uniform(from, to, num, samples);
+  }
+
+  void Sample
+  ::uniform(int num, double * samples)
+  {
+    engine().uniform(num, samples);
+  }
+
+  void Sample
+  ::gaussian(double sigma, int num, double * samples)
+  {
+    engine().gaussian(sigma, num, samples);
   }
-}
 
+  void Sample
+  ::subset(int n, int k, int * ids)
+  {
+    engine().subset(n, k, ids);
+  }
+}
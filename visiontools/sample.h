@@ -20,15 +20,105 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+
 #ifndef VISIONTOOLS_SAMPLE_H
 #define VISIONTOOLS_SAMPLE_H
 
-#include <tr1/random>
+#include <stdint.h>
+
+#include <cassert>
+#include <vector>
+#include <cmath>
 
 namespace VisionTools
 {
   using namespace std;
 
+  //xoshiro256** pseudo random number generator (Blackman & Vigna).
+  //(seed, stream) pairs give independent, reproducible sequences, so
+  //parallel code can give each task its own engine.
+  class RandomEngine
+  {
+  public:
+    explicit
+    RandomEngine             (uint64_t seed=0, uint64_t stream=0);
+
+    void
+    seed                     (uint64_t seed, uint64_t stream=0);
+
+    uint64_t next()
+    {
+      const uint64_t result = rotl(s_[1]*5, 7)*9;
+      const uint64_t t = s_[1] << 17;
+      s_[2] ^= s_[0];
+      s_[3] ^= s_[1];
+      s_[1] ^= s_[2];
+      s_[0] ^= s_[3];
+      s_[2] ^= t;
+      s_[3] = rotl(s_[3], 45);
+      return result;
+    }
+
+    //in [0,1)
+    double uniform()
+    {
+      return (next() >> 11)*(1./9007199254740992.);
+    }
+
+    //in [from,to], unbiased (Lemire's multiply-shift with rejection);
+    //unsigned arithmetic, so any span up to the full int range is fine
+    int uniform(int from, int to)
+    {
+      uint32_t range
+          = static_cast<uint32_t>(to)-static_cast<uint32_t>(from)+1;
+      if (range==0)
+        return static_cast<int>(next() >> 32);
+      uint64_t m = static_cast<uint64_t>(next() >> 32)*range;
+      uint32_t low = static_cast<uint32_t>(m);
+      if (low<range)
+      {
+        uint32_t threshold = -range % range;
+        while (low<threshold)
+        {
+          m = static_cast<uint64_t>(next() >> 32)*range;
+          low = static_cast<uint32_t>(m);
+        }
+      }
+      return static_cast<int>(static_cast<uint32_t>(from)
+                              + static_cast<uint32_t>(m >> 32));
+    }
+
+    double
+    gaussian                 (double sigma);
+
+    //bulk versions: draw raw numbers first, then transform whole arrays
+    void
+    uniform                  (int from, int to, int num, int * samples);
+    void
+    uniform                  (int num, double * samples);
+    void
+    gaussian                 (double sigma, int num, double * samples);
+
+    //k distinct ids out of [0,n), without rejection loops
+    void
+    subset                   (int n, int k, int * ids);
+    //moves k random elements of pool to its front (partial Fisher-Yates);
+    //reusing pool across calls avoids the O(n) setup
+    void
+    subset                   (int k, vector<int> * pool);
+
+  private:
+    static uint64_t rotl(uint64_t x, int k)
+    {
+      return (x << k) | (x >> (64-k));
+    }
+
+    uint64_t s_[4];
+  };
+
+  //Convenience functions using one engine per thread. Thread engines are
+  //seeded with (base seed, n) for the n-th thread to draw a sample, so for
+  //reproducible parallel code pass explicit RandomEngines instead.
   class Sample
   {
   public:
@@ -38,11 +128,171 @@ namespace VisionTools
     uniform                  ();
     static double
     gaussian                 (double sigma);
+    static void
+    uniform                  (int from, int to, int num, int * samples);
+    static void
+    uniform                  (int num, double * samples);
+    static void
+    gaussian                 (double sigma, int num, double * samples);
+    static void
+    subset                   (int n, int k, int * ids);
+
+    static RandomEngine &    //engine of the calling thread
+    engine                   ();
+    static void              //reseeds the calling thread, restarts streams
+    seed                     (uint64_t seed);
+
+    //Deprecated stand-ins for the former tr1 generators gen_real and
+    //gen_int, kept so that old code still compiles. They draw from (and
+    //seed() reseeds) the calling thread's engine.
+    struct RealGenerator
+    {
+      typedef double result_type;
+      result_type min() const { return 0.; }
+      result_type max() const { return 1.; }
+      result_type operator()() { return engine().uniform(); }
+      void seed(uint64_t s) { Sample::seed(s); }
+    };
 
-    static tr1::ranlux_base_01 gen_real;
-    static tr1::mt19937 gen_int;
+    struct IntGenerator
+    {
+      typedef uint32_t result_type;
+      result_type min() const { return 0; }
+      result_type max() const { return 0xffffffffu; }
+      result_type operator()() { return engine().next() >> 32; }
+      void seed(uint64_t s) { Sample::seed(s); }
+    };
+
+    static RealGenerator gen_real __attribute__((deprecated));
+    static IntGenerator gen_int __attribute__((deprecated));
   };
 
+  //Weighted sampling of ids in [0,n) with O(1) draws after O(n) setup
+  //(Vose's alias method). Weights need not be normalised.
+  class AliasTable
+  {
+  public:
+    AliasTable               (){}
+    AliasTable               (const vector<double> & weights);
+
+    void
+    init                     (const double * weights, int n);
+
+    int sample(RandomEngine * rng) const
+    {
+      assert(!prob_.empty());
+      int i = rng->uniform(0, prob_.size()-1);
+      return rng->uniform()<prob_[i] ? i : alias_[i];
+    }
+
+    void
+    sample                   (RandomEngine * rng, int num, int * ids) const;
+
+    int size() const
+    {
+      return prob_.size();
+    }
+
+  private:
+    vector<double> prob_;
+    vector<int> alias_;
+  };
+
+  //Uniform sample of k elements out of a stream of unknown length
+  //(Li's Algorithm L: only O(k(1+log(N/k))) random numbers are drawn).
+  //With k==0 elements are only counted.
+  template <class T>
+  class ReservoirSampler
+  {
+  public:
+    ReservoirSampler         (int k, uint64_t seed=0, uint64_t stream=0)
+      : k_(k), num_seen_(0), next_(0), w_(1.), rng_(seed, stream)
+    {
+      assert(k>=0);
+      samples_.reserve(k);
+    }
+
+    void
+    push                     (const T & elem);
+
+    //true if the next pushed element would be kept; allows skipping the
+    //construction of elements that are going to be dropped anyway
+    bool accepts_next() const
+    {
+      return k_>0 && (num_seen_<k_ || num_seen_==next_);
+    }
+
+    const vector<T> & samples() const
+    {
+      return samples_;
+    }
+
+    long num_seen() const
+    {
+      return num_seen_;
+    }
+
+    void
+    clear                    ();
+
+  private:
+    void
+    advance                  ();
+
+    int k_;
+    long num_seen_;
+    long next_;
+    double w_;
+    RandomEngine rng_;
+    vector<T> samples_;
+  };
+
+  template <class T>
+  void ReservoirSampler<T>
+  ::push(const T & elem)
+  {
+    if (k_==0)
+    {
+      ++num_seen_;
+      return;
+    }
+    if (num_seen_<k_)
+    {
+      samples_.push_back(elem);
+      if (num_seen_==k_-1)
+      {
+        w_ = std::exp(std::log(1.-rng_.uniform())/k_);
+        advance();
+      }
+    }
+    else if (num_seen_==next_)
+    {
+      samples_[rng_.uniform(0, k_-1)] = elem;
+      w_ *= std::exp(std::log(1.-rng_.uniform())/k_);
+      advance();
+    }
+    ++num_seen_;
+  }
+
+  template <class T>
+  void ReservoirSampler<T>
+  ::advance()
+  {
+    double skip = std::floor(std::log(1.-rng_.uniform())/std::log(1.-w_));
+    next_ = skip<1e18 ? num_seen_ + static_cast<long>(skip) + 1
+                      : static_cast<long>(1e18);
+  }
+
+  template <class T>
+  void ReservoirSampler<T>
+  ::clear()
+  {
+    samples_.clear();
+    num_seen_ = 0;
+    next_ = 0;
+    w_ = 1.;
+  }
+
 }
 
 #endif
@@ -0,0 +1,264 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef VISIONTOOLS_SLOT_MAP_H
+#define VISIONTOOLS_SLOT_MAP_H
+
+#include <stdint.h>
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include <tr1/functional>
+
+namespace VisionTools
+{
+using namespace std;
+
+//Stable id of a SlotMap element. A handle of an erased element stays
+//invalid even if its slot gets reused; default constructed handles are
+//never valid.
+struct SlotHandle
+{
+  SlotHandle() : index(0), generation(0) {}
+
+  SlotHandle(uint32_t index, uint32_t generation)
+    : index(index), generation(generation)
+  {
+  }
+
+  bool operator==(const SlotHandle & other) const
+  {
+    return index==other.index && generation==other.generation;
+  }
+
+  bool operator!=(const SlotHandle & other) const
+  {
+    return !(*this==other);
+  }
+
+  bool operator<(const SlotHandle & other) const
+  {
+    return index<other.index
+        || (index==other.index && generation<other.generation);
+  }
+
+  uint32_t index;
+  uint32_t generation;
+};
+
+//Elements are kept contiguous in a vector: insert and erase are O(1)
+//(erase moves the last element into the gap), and iteration runs over
+//live elements in memory order. Handles map to elements through an
+//indirection table, so lookups are two array accesses without hashing.
+//Pointers and iterators are invalidated by insert and erase; handles
+//are not.
+template <class VAL>
+class SlotMap
+{
+public:
+  typedef typename vector<VAL>::iterator iterator;
+  typedef typename vector<VAL>::const_iterator const_iterator;
+
+  SlotMap() : free_head_(NONE) {}
+
+  SlotHandle
+  insert                     (const VAL & val);
+  bool                       //false if handle was not valid
+  erase                      (const SlotHandle & handle);
+  void
+  clear                      ();
+  void
+  reserve                    (size_t num);
+
+  bool contains(const SlotHandle & handle) const
+  {
+    return handle.index<slots_.size()
+        && slots_[handle.index].generation==handle.generation;
+  }
+
+  //NULL if handle is not valid
+  VAL * get(const SlotHandle & handle)
+  {
+    return contains(handle) ? &values_[slots_[handle.index].dense] : NULL;
+  }
+
+  const VAL * get(const SlotHandle & handle) const
+  {
+    return contains(handle) ? &values_[slots_[handle.index].dense] : NULL;
+  }
+
+  VAL & operator[](const SlotHandle & handle)
+  {
+    assert(contains(handle));
+    return values_[slots_[handle.index].dense];
+  }
+
+  const VAL & operator[](const SlotHandle & handle) const
+  {
+    assert(contains(handle));
+    return values_[slots_[handle.index].dense];
+  }
+
+  //handle of the element at position i of the dense storage
+  SlotHandle handle(size_t i) const
+  {
+    uint32_t index = dense_to_slot_[i];
+    return SlotHandle(index, slots_[index].generation);
+  }
+
+  iterator begin()
+  {
+    return values_.begin();
+  }
+
+  iterator end()
+  {
+    return values_.end();
+  }
+
+  const_iterator begin() const
+  {
+    return values_.begin();
+  }
+
+  const_iterator end() const
+  {
+    return values_.end();
+  }
+
+  size_t size() const
+  {
+    return values_.size();
+  }
+
+  bool empty() const
+  {
+    return values_.empty();
+  }
+
+private:
+  static const uint32_t NONE = 0xFFFFFFFF;
+
+  struct Slot
+  {
+    uint32_t dense;          //position in values_, or next free slot
+    uint32_t generation;     //odd while the slot is in use
+  };
+
+  vector<VAL> values_;
+  vector<uint32_t> dense_to_slot_;
+  vector<Slot> slots_;
+  uint32_t free_head_;
+};
+
+template <class VAL>
+SlotHandle SlotMap<VAL>
+::insert(const VAL & val)
+{
+  uint32_t index;
+  if (free_head_!=NONE)
+  {
+    index = free_head_;
+    free_head_ = slots_[index].dense;
+  }
+  else
+  {
+    index = slots_.size();
+    Slot slot;
+    slot.generation = 0;
+    slots_.push_back(slot);
+  }
+  Slot & slot = slots_[index];
+  ++slot.generation;
+  slot.dense = values_.size();
+  values_.push_back(val);
+  dense_to_slot_.push_back(index);
+  return SlotHandle(index, slot.generation);
+}
+
+template <class VAL>
+bool SlotMap<VAL>
+::erase(const SlotHandle & handle)
+{
+  if (!contains(handle))
+    return false;
+  Slot & slot = slots_[handle.index];
+  uint32_t dense = slot.dense;
+  uint32_t last = values_.size()-1;
+  if (dense!=last)
+  {
+    values_[dense] = values_[last];
+    dense_to_slot_[dense] = dense_to_slot_[last];
+    slots_[dense_to_slot_[dense]].dense = dense;
+  }
+  values_.pop_back();
+  dense_to_slot_.pop_back();
+  ++slot.generation;
+  slot.dense = free_head_;
+  free_head_ = handle.index;
+  return true;
+}
+
+template <class VAL>
+void SlotMap<VAL>
+::clear()
+{
+  for (size_t i=0; i<dense_to_slot_.size(); ++i)
+  {
+    uint32_t index = dense_to_slot_[i];
+    ++slots_[index].generation;
+    slots_[index].dense = free_head_;
+    free_head_ = index;
+  }
+  values_.clear();
+  dense_to_slot_.clear();
+}
+
+template <class VAL>
+void SlotMap<VAL>
+::reserve(size_t num)
+{
+  values_.reserve(num);
+  dense_to_slot_.reserve(num);
+  slots_.reserve(num);
+}
+
+}
+
+namespace std
+{
+namespace tr1
+{
+template <>
+struct hash<VisionTools::SlotHandle>
+{
+  size_t operator()(const VisionTools::SlotHandle & h) const
+  {
+    return (static_cast<uint64_t>(h.generation) << 32) | h.index;
+  }
+};
+}
+}
+
+#endif
@@ -20,71 +20,150 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+
 #ifndef VISIONTOOLS_STOP_WATCH_H
 #define VISIONTOOLS_STOP_WATCH_H
 
 #include <cassert>
-#include <sys/time.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
 #include <stdexcept>
 
 
 namespace VisionTools
 {
 
+//Accumulates the time of all start/stop pairs since the last reset.
+//MONOTONIC uses clock_gettime(CLOCK_MONOTONIC) (nanosecond resolution,
+//not affected by NTP adjustments). CYCLE_COUNTER reads the time stamp
+//counter, which is cheaper to read but only meaningful on machines with an
+//invariant TSC; it is calibrated against the monotonic clock once.
 class   StopWatch
 {
 public:
-  StopWatch()
+  enum Clock
+  {
+    MONOTONIC,
+    CYCLE_COUNTER
+  };
+
+  StopWatch(Clock clock = MONOTONIC)
   {
+    clock_ = clock;
+    seconds_per_tick_ = clock==CYCLE_COUNTER ? 1./cycles_per_second() : 1e-9;
     running_ = false;
     time_ = 0;
+    last_time_ = 0;
+    num_laps_ = 0;
   }
 
   void start()
   {
     assert(running_==false);
-    gettimeofday(&start_time_, NULL);
     running_ = true;
+    start_ticks_ = ticks();
   }
 
   void stop()
   {
+    int64_t end_ticks = ticks();
     assert(running_);
-    gettimeofday(&end_time_, NULL);
-    long seconds  = end_time_.tv_sec  - start_time_.tv_sec;
-    long useconds = end_time_.tv_usec - start_time_.tv_usec;
-    time_ = ((seconds) + useconds*0.000001);
+    last_time_ = (end_ticks-start_ticks_)*seconds_per_tick_;
+    time_ += last_time_;
+    ++num_laps_;
     running_ = false;
   }
 
   double read_current_time()
   {
     assert(running_);
-    timeval cur_time;
-    gettimeofday(&cur_time, NULL);
-    long seconds  = cur_time.tv_sec  - start_time_.tv_sec;
-    long useconds = cur_time.tv_usec - start_time_.tv_usec;
-    return ((seconds) + useconds*0.000001);
+    return (ticks()-start_ticks_)*seconds_per_tick_;
   }
 
+  //accumulated time of all start/stop pairs since the last reset
   double get_stopped_time()
   {
     assert(running_==false);
     return time_;
   }
 
+  //time of the last start/stop pair only
+  double get_last_time()
+  {
+    assert(running_==false);
+    return last_time_;
+  }
+
+  int get_num_laps()
+  {
+    return num_laps_;
+  }
+
   inline void reset()
   {
     time_ = 0;
+    last_time_ = 0;
+    num_laps_ = 0;
+  }
+
+  static int64_t monotonic_ns()
+  {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return static_cast<int64_t>(t.tv_sec)*1000000000 + t.tv_nsec;
+  }
+
+  //falls back to monotonic_ns on architectures without a cycle counter
+  static int64_t cycles()
+  {
+#if defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return monotonic_ns();
+#endif
+  }
+
+  static double cycles_per_second()
+  {
+    static double cps = calibrate_cycles();
+    return cps;
   }
 
 private:
-  timeval start_time_;
-  timeval end_time_;
+  static double calibrate_cycles()
+  {
+#if defined(__i386__) || defined(__x86_64__)
+    int64_t start_ns = monotonic_ns();
+    int64_t start_cycles = cycles();
+    int64_t ns;
+    do
+    {
+      ns = monotonic_ns();
+    } while(ns-start_ns<20000000);
+    return (cycles()-start_cycles)*1e9/(ns-start_ns);
+#else
+    return 1e9;
+#endif
+  }
+
+  int64_t ticks() const
+  {
+    return clock_==CYCLE_COUNTER ? cycles() : monotonic_ns();
+  }
+
+  Clock clock_;
+  double seconds_per_tick_;
+  int64_t start_ticks_;
   double time_;
+  double last_time_;
+  int num_laps_;
   bool running_;
 };
 }
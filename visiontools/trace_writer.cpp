@@ -0,0 +1,256 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#include <stdexcept>
+
+#include "trace_writer.h"
+
+namespace VisionTools
+{
+using namespace std;
+
+namespace
+{
+string jsonEscape(const string & str)
+{
+  string escaped;
+  for (size_t i=0; i<str.size(); ++i)
+  {
+    unsigned char c = str[i];
+    if (c=='"' || c=='\\')
+    {
+      escaped += '\\';
+      escaped += c;
+    }
+    else if (c<0x20)
+    {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      escaped += buf;
+    }
+    else
+    {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+//quotes the field if it contains a separator, quote or line break
+string csvEscape(const string & str)
+{
+  if (str.find_first_of(",\"\r\n")==string::npos)
+    return str;
+  string escaped = "\"";
+  for (size_t i=0; i<str.size(); ++i)
+  {
+    if (str[i]=='"')
+      escaped += '"';
+    escaped += str[i];
+  }
+  escaped += '"';
+  return escaped;
+}
+}
+
+TraceWriter
+::TraceWriter(const string & filename,
+              Format format,
+              const vector<string> & names,
+              int capacity)
+  : format_(format),
+    names_(names),
+    capacity_(capacity),
+    first_event_(true),
+    stop_(false),
+    num_dropped_(0)
+{
+  file_ = fopen(filename.c_str(), format==BINARY ? "wb" : "w");
+  if (file_==NULL)
+  {
+    throw std::runtime_error("TraceWriter: cannot open " + filename);
+  }
+  setvbuf(file_, NULL, _IOFBF, 1<<20);
+  //text formats print the names once per record, so escape them up front
+  if (format_!=BINARY)
+  {
+    escaped_names_.resize(names_.size());
+    for (size_t i=0; i<names_.size(); ++i)
+    {
+      escaped_names_[i] = format_==CHROME_TRACE ? jsonEscape(names_[i])
+                                                : csvEscape(names_[i]);
+    }
+  }
+  front_.reserve(capacity_);
+  back_.reserve(capacity_);
+  write_header();
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&cond_, NULL);
+  pthread_create(&thread_, NULL, &TraceWriter::run, this);
+}
+
+TraceWriter
+::~TraceWriter()
+{
+  close();
+}
+
+bool TraceWriter
+::push(const Record * records, int num)
+{
+  pthread_mutex_lock(&mutex_);
+  int num_free = capacity_-front_.size();
+  int num_copied = num<num_free ? num : num_free;
+  front_.insert(front_.end(), records, records+num_copied);
+  pthread_mutex_unlock(&mutex_);
+  pthread_cond_signal(&cond_);
+  if (num_copied<num)
+  {
+    __atomic_add_fetch(&num_dropped_, num-num_copied, __ATOMIC_RELAXED);
+    return false;
+  }
+  return true;
+}
+
+void TraceWriter
+::close()
+{
+  if (file_==NULL)
+    return;
+  pthread_mutex_lock(&mutex_);
+  stop_ = true;
+  pthread_mutex_unlock(&mutex_);
+  pthread_cond_signal(&cond_);
+  pthread_join(thread_, NULL);
+  write_footer();
+  fclose(file_);
+  file_ = NULL;
+  pthread_cond_destroy(&cond_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+void * TraceWriter
+::run(void * self)
+{
+  TraceWriter * writer = static_cast<TraceWriter *>(self);
+  for (;;)
+  {
+    pthread_mutex_lock(&writer->mutex_);
+    while (writer->front_.empty() && !writer->stop_)
+    {
+      pthread_cond_wait(&writer->cond_, &writer->mutex_);
+    }
+    bool stop = writer->stop_;
+    writer->front_.swap(writer->back_);
+    pthread_mutex_unlock(&writer->mutex_);
+
+    writer->write_records(writer->back_);
+    writer->back_.clear();
+    if (stop)
+      break;
+  }
+  return NULL;
+}
+
+const char * TraceWriter
+::name(int timer) const
+{
+  if (timer<0 || timer>=static_cast<int>(escaped_names_.size()))
+    return "frame";
+  return escaped_names_[timer].c_str();
+}
+
+void TraceWriter
+::write_header()
+{
+  if (format_==CHROME_TRACE)
+  {
+    fprintf(file_, "[\n");
+  }
+  else if (format_==CSV)
+  {
+    fprintf(file_, "frame,timer,depth,start_us,duration_us,count\n");
+  }
+  else
+  {
+    fwrite("VTTRACE1", 1, 8, file_);
+    int32_t num_names = names_.size();
+    fwrite(&num_names, sizeof(num_names), 1, file_);
+    for (int i=0; i<num_names; ++i)
+    {
+      int32_t len = names_[i].size();
+      fwrite(&len, sizeof(len), 1, file_);
+      fwrite(names_[i].data(), 1, len, file_);
+    }
+  }
+}
+
+void TraceWriter
+::write_records(const vector<Record> & records)
+{
+  if (format_==BINARY)
+  {
+    if (!records.empty())
+      fwrite(&records[0], sizeof(Record), records.size(), file_);
+    return;
+  }
+  for (size_t i=0; i<records.size(); ++i)
+  {
+    const Record & r = records[i];
+    if (format_==CHROME_TRACE)
+    {
+      fprintf(file_,
+              "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,"
+              "\"ts\":%.3f,\"dur\":%.3f,"
+              "\"args\":{\"frame\":%lld,\"count\":%d}}",
+              first_event_ ? "" : ",\n",
+              name(r.timer),
+              r.start_ns*1e-3,
+              r.duration_ns*1e-3,
+              static_cast<long long>(r.frame),
+              r.count);
+      first_event_ = false;
+    }
+    else
+    {
+      fprintf(file_, "%lld,%s,%d,%.3f,%.3f,%d\n",
+              static_cast<long long>(r.frame),
+              name(r.timer),
+              r.depth,
+              r.start_ns*1e-3,
+              r.duration_ns*1e-3,
+              r.count);
+    }
+  }
+}
+
+void TraceWriter
+::write_footer()
+{
+  if (format_==CHROME_TRACE)
+  {
+    fprintf(file_, "\n]\n");
+  }
+}
+
+}
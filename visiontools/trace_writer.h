@@ -0,0 +1,116 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#ifndef VISIONTOOLS_TRACE_WRITER_H
+#define VISIONTOOLS_TRACE_WRITER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+namespace VisionTools
+{
+
+//Streams timing records to a file from a background thread. push() copies
+//the records into a preallocated buffer and returns immediately; the
+//writer thread swaps buffers and does all formatting and I/O. If the
+//buffer is full, records are dropped and counted instead of blocking.
+class TraceWriter
+{
+public:
+  enum Format
+  {
+    CHROME_TRACE,  //Trace Event JSON, loads in chrome://tracing / Perfetto
+    CSV,
+    BINARY         //header, name table, then raw Record structs
+  };
+
+  //timer < 0 denotes the whole frame
+  struct Record
+  {
+    int64_t frame;
+    int64_t start_ns;
+    int64_t duration_ns;
+    int32_t timer;
+    int32_t depth;
+    int32_t count;
+    int32_t reserved;
+  };
+
+  TraceWriter                (const std::string & filename,
+                              Format format,
+                              const std::vector<std::string> & names,
+                              int capacity = 65536);
+  ~TraceWriter               ();
+
+  bool                       //false if (some) records had to be dropped
+  push                       (const Record * records, int num);
+  void                       //flushes remaining records and closes the file
+  close                      ();
+
+  bool is_open() const
+  {
+    return file_!=NULL;
+  }
+
+  long num_dropped() const
+  {
+    return __atomic_load_n(&num_dropped_, __ATOMIC_RELAXED);
+  }
+
+private:
+  TraceWriter(const TraceWriter &);
+  TraceWriter & operator=(const TraceWriter &);
+
+  static void *
+  run                        (void * self);
+  void
+  write_header               ();
+  void
+  write_records              (const std::vector<Record> & records);
+  void
+  write_footer               ();
+  const char *               //escaped for the text format in use
+  name                       (int timer) const;
+
+  FILE * file_;
+  Format format_;
+  std::vector<std::string> names_;
+  std::vector<std::string> escaped_names_;
+  size_t capacity_;
+  bool first_event_;
+  bool stop_;
+  long num_dropped_;
+  std::vector<Record> front_;
+  std::vector<Record> back_;
+  pthread_t thread_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+};
+
+}
+
+#endif
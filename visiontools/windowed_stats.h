@@ -0,0 +1,215 @@
+// This file is part of VisionTools.
+//
+// Copyright 2011 Hauke Strasdat (Imperial College London)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+#ifndef VISIONTOOLS_WINDOWED_STATS_H
+#define VISIONTOOLS_WINDOWED_STATS_H
+
+#include <vector>
+#include <cassert>
+
+#include "ringbuffer.h"
+
+namespace VisionTools
+{
+
+//Statistics over the last window_size elements pushed. sum, mean and
+//(population) variance are updated incrementally; min and max use
+//monotonic deques of element indices. push_back is amortised O(1), all
+//queries are O(1). The running sums are recomputed from scratch once per
+//window to stop rounding errors from accumulating.
+template<typename T>
+class WindowedStats
+{
+public:
+  WindowedStats              (int window_size);
+
+  void
+  push_back                  (const T & elem);
+
+  const T & get(int i) const
+  {
+    return values_.get(i);
+  }
+
+  int size() const
+  {
+    return values_.size();
+  }
+
+  double sum() const
+  {
+    return mean_*size();
+  }
+
+  double mean() const
+  {
+    return mean_;
+  }
+
+  double variance() const
+  {
+    int n = size();
+    return n==0 || m2_<0 ? 0. : m2_/n;
+  }
+
+  const T & min() const
+  {
+    assert(size()>0);
+    return value(min_deque_.front());
+  }
+
+  const T & max() const
+  {
+    assert(size()>0);
+    return value(max_deque_.front());
+  }
+
+private:
+  //fixed capacity deque of element indices
+  struct IndexDeque
+  {
+    IndexDeque(int capacity) : arr(capacity), begin(0), num(0) {}
+
+    long front() const
+    {
+      return arr[begin];
+    }
+    long back() const
+    {
+      return arr[(begin+num-1)%arr.size()];
+    }
+    void pop_front()
+    {
+      if (++begin==static_cast<int>(arr.size()))
+        begin = 0;
+      --num;
+    }
+    void pop_back()
+    {
+      --num;
+    }
+    void push_back(long idx)
+    {
+      arr[(begin+num)%arr.size()] = idx;
+      ++num;
+    }
+    bool empty() const
+    {
+      return num==0;
+    }
+
+    std::vector<long> arr;
+    int begin;
+    int num;
+  };
+
+  const T & value(long idx) const
+  {
+    return values_.get(idx-(count_-values_.size()));
+  }
+
+  void recompute();
+
+  RingBuffer<T> values_;
+  int window_size_;
+  long count_;
+  double mean_;
+  double m2_;
+  IndexDeque min_deque_;
+  IndexDeque max_deque_;
+};
+
+template <class T>
+WindowedStats<T>
+::WindowedStats(int window_size)
+  : values_(window_size),
+    window_size_(window_size),
+    count_(0),
+    mean_(0),
+    m2_(0),
+    min_deque_(window_size),
+    max_deque_(window_size)
+{
+}
+
+template <class T>
+void WindowedStats<T>
+::push_back(const T & elem)
+{
+  double x = elem;
+  if (size()==window_size_)
+  {
+    //replace the oldest element (Welford update with removal)
+    long oldest = count_-window_size_;
+    double old = values_.get(0);
+    double new_mean = mean_ + (x-old)/window_size_;
+    m2_ += (x-old)*(x-new_mean+old-mean_);
+    mean_ = new_mean;
+    if (min_deque_.front()==oldest)
+      min_deque_.pop_front();
+    if (max_deque_.front()==oldest)
+      max_deque_.pop_front();
+  }
+  else
+  {
+    double delta = x-mean_;
+    mean_ += delta/(size()+1);
+    m2_ += delta*(x-mean_);
+  }
+
+  while (!min_deque_.empty() && !(value(min_deque_.back())<elem))
+    min_deque_.pop_back();
+  while (!max_deque_.empty() && !(elem<value(max_deque_.back())))
+    max_deque_.pop_back();
+
+  values_.push_back(elem);
+  ++count_;
+  min_deque_.push_back(count_-1);
+  max_deque_.push_back(count_-1);
+
+  if (count_%window_size_==0)
+    recompute();
+}
+
+template <class T>
+void WindowedStats<T>
+::recompute()
+{
+  int n = size();
+  double sum = 0;
+  for (int i=0; i<n; ++i)
+  {
+    sum += values_.get(i);
+  }
+  mean_ = sum/n;
+  m2_ = 0;
+  for (int i=0; i<n; ++i)
+  {
+    double d = values_.get(i)-mean_;
+    m2_ += d*d;
+  }
+}
+
+}
+
+#endif